@@ -8,3 +8,18 @@ add_test(NAME t_backprop COMMAND backprop)
 add_test(NAME t_similarity COMMAND similarity)
 add_test(NAME t_minhash COMMAND minhash)
 add_test(NAME t_locality_sensitive_hash COMMAND locality-sensitive-hash)
+add_test(NAME t_mix_kernels COMMAND mix-kernels)
+add_test(NAME t_spsc_ring_buffer COMMAND spsc-ring-buffer)
+add_test(NAME t_fused_inference COMMAND fused-inference)
+add_test(NAME t_parallel_training COMMAND parallel-training)
+add_test(NAME t_optimizers COMMAND optimizers)
+add_test(NAME t_flat_network COMMAND flat-network)
+add_test(NAME t_binary_network COMMAND binary-network)
+add_test(NAME t_quantized_inference COMMAND quantized-inference)
+add_test(NAME t_dynamic_network COMMAND dynamic-network)
+add_test(NAME t_backprop_benchmark COMMAND backprop-benchmark)
+add_test(NAME t_batch_queue COMMAND batch-queue)
+add_test(NAME t_midi_parser COMMAND midi-parser)
+add_test(NAME t_midi_merge_benchmark COMMAND midi-merge-benchmark)
+add_test(NAME t_packed_piano_roll COMMAND packed-piano-roll)
+add_test(NAME t_simplenn_window COMMAND simplenn-window)
@@ -12,6 +12,7 @@
 
 #include "alsa_devices.hh"
 #include "exception.hh"
+#include "mix_kernels.hh"
 #include "timestamp.hh"
 
 using namespace std;
@@ -237,6 +238,9 @@ bool AudioInterface::update()
 
 void AudioInterface::recover()
 {
+  if ( state() == SND_PCM_STATE_XRUN ) {
+    statistics_.xruns++;
+  }
   statistics_.recoveries++;
   statistics_.last_recovery = cursor();
   drop();
@@ -307,10 +311,22 @@ inline float sample_to_float( const int32_t sample )
   return ret;
 }
 
-inline int32_t float_to_sample( const float sample_f )
+/* convert `frames` frames starting at `pos` into interleaved samples, as silence where outside the buffer */
+static void convert_channels( int32_t* dest, const ChannelPair& playback, size_t pos, size_t frames )
 {
-  constexpr float maxval = uint64_t( 1 ) << 31;
-  return lrint( clamp( sample_f, -1.0f, 1.0f ) * maxval );
+  const size_t silent_before = min( frames, pos < playback.range_begin() ? playback.range_begin() - pos : 0 );
+  fill( dest, dest + 2 * silent_before, 0 );
+  dest += 2 * silent_before;
+  pos += silent_before;
+  frames -= silent_before;
+
+  const size_t stored = min( frames, pos < playback.range_end() ? playback.range_end() - pos : 0 );
+  if ( stored ) {
+    MixKernels::planar_to_int32(
+      dest, playback.ch1().region( pos, stored ).data(), playback.ch2().region( pos, stored ).data(), stored );
+  }
+
+  fill( dest + 2 * stored, dest + 2 * frames, 0 );
 }
 
 void AudioInterface::play( const size_t play_until_sample, const ChannelPair& playback_input )
@@ -328,29 +344,70 @@ void AudioInterface::play( const size_t play_until_sample, const ChannelPair& pl
     return;
   }
 
-  const unsigned int samples_available_to_play = play_until_sample - cursor();
+  const unsigned int frames_wanted = min( play_until_sample - cursor(), size_t( avail() ) );
+  unsigned int frames_played = 0;
 
-  Buffer write_buf { *this, samples_available_to_play };
+  if ( frames_wanted == 0 ) {
+    throw runtime_error( "AudioInterface::play(): no available buffer space" );
+  }
 
-  const unsigned int frames_to_play = write_buf.frame_count();
+  /* the mmap area is a ring, so the space may come back in two pieces */
+  for ( unsigned int chunk = 0; chunk < 2 and frames_played < frames_wanted; chunk++ ) {
+    Buffer write_buf { *this, frames_wanted - frames_played };
 
-  if ( frames_to_play == 0 ) {
-    throw runtime_error( "AudioInterface::play(): no available buffer space" );
+    const unsigned int frame_count = write_buf.frame_count();
+
+    convert_channels( write_buf.interleaved_samples(), playback_input, cursor_, frame_count );
+
+    cursor_ += frame_count;
+    frames_played += frame_count;
+
+    write_buf.commit();
   }
 
-  for ( unsigned int i = 0; i < frames_to_play; i++ ) {
-    /* play from input buffer + captured sample */
-    const auto playback_sample = playback_input.safe_get( cursor_ );
+  start_if_ready( frames_played );
+}
 
-    write_buf.sample( false, i ) = float_to_sample( playback_sample.first );
-    write_buf.sample( true, i ) = float_to_sample( playback_sample.second );
+size_t AudioInterface::play( const span_view<pair<float, float>> frames )
+{
+  statistics_.wakeups++;
 
-    cursor_++;
+  if ( update() ) {
+    recover();
+    fd_.value().register_write();
+    return 0;
   }
 
-  write_buf.commit();
+  if ( frames.size() == 0 ) {
+    /* nothing to play */
+    return 0;
+  }
+
+  const unsigned int frames_wanted = min( frames.size(), size_t( avail() ) );
+  unsigned int frames_played = 0;
+
+  /* the mmap area is a ring, so the space may come back in two pieces */
+  for ( unsigned int chunk = 0; chunk < 2 and frames_played < frames_wanted; chunk++ ) {
+    Buffer write_buf { *this, frames_wanted - frames_played };
 
-  if ( delay() + frames_to_play >= config_.start_threshold and state() == SND_PCM_STATE_PREPARED ) {
+    const unsigned int frame_count = write_buf.frame_count();
+
+    MixKernels::to_int32( write_buf.interleaved_samples(), frames.data() + frames_played, frame_count );
+
+    cursor_ += frame_count;
+    frames_played += frame_count;
+
+    write_buf.commit();
+  }
+
+  start_if_ready( frames_played );
+
+  return frames_played;
+}
+
+void AudioInterface::start_if_ready( const unsigned int frames_played )
+{
+  if ( delay() + frames_played >= config_.start_threshold and state() == SND_PCM_STATE_PREPARED ) {
     start();
   }
 
@@ -426,6 +483,10 @@ void AudioInterface::summary( ostream& out ) const
     out << " total recoveries=" << statistics().recoveries;
   }
 
+  if ( statistics().xruns ) {
+    out << " xruns=" << statistics().xruns;
+  }
+
   if ( statistics().last_recovery ) {
     out << " last recovery=";
     pp_samples( out, cursor() - statistics().last_recovery );
@@ -9,6 +9,7 @@
 
 #include "audio_buffer.hh"
 #include "file_descriptor.hh"
+#include "spans.hh"
 #include "summarize.hh"
 
 class ALSADevices
@@ -38,6 +39,7 @@ struct AudioStatistics
 {
   size_t last_recovery;
   unsigned int recoveries;
+  unsigned int xruns; // recoveries from an underrun, rather than another error
 
   /* these statistics are reset every stats interval */
   unsigned int wakeups;
@@ -61,6 +63,8 @@ class AudioInterface : public Summarizable
 
   AudioStatistics statistics_ {};
 
+  void start_if_ready( const unsigned int frames_played );
+
   class Buffer
   {
     snd_pcm_t* pcm_;
@@ -79,6 +83,9 @@ class AudioInterface : public Summarizable
       return *( static_cast<int32_t*>( areas_[0].addr ) + right_channel + 2 * ( offset_ + sample_num ) );
     }
 
+    /* the frames of the buffer as interleaved (left, right) samples */
+    int32_t* interleaved_samples() { return &sample( false, 0 ); }
+
     /* can't copy or assign */
     Buffer( const Buffer& other ) = delete;
     Buffer& operator=( const Buffer& other ) = delete;
@@ -128,6 +135,9 @@ public:
 
   void play( const size_t play_until_sample, const ChannelPair& playback );
 
+  // Play a block of frames starting at cursor(); returns how many fit in the output buffer
+  size_t play( const span_view<std::pair<float, float>> frames );
+
   void summary( std::ostream& out ) const override;
   void reset_summary() override;
 
@@ -0,0 +1,76 @@
+#include "midi_corpus.hh"
+#include "timer.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+using namespace std;
+
+MidiCorpus::MidiCorpus( const string& directory )
+{
+  vector<string> filenames;
+  for ( const auto& entry : filesystem::directory_iterator( directory ) ) {
+    if ( entry.path().extension() == ".mid" ) {
+      filenames.push_back( entry.path() );
+    }
+  }
+  sort( filenames.begin(), filenames.end() );
+
+  /* each file has its own slot, so the order does not depend on timing */
+  vector<optional<MidiFile>> parsed( filenames.size() );
+  atomic<size_t> next_file { 0 };
+  mutex report_mutex {};
+
+  auto parse_worker = [&] {
+    for ( size_t i = next_file++; i < parsed.size(); i = next_file++ ) {
+      try {
+        parsed[i].emplace( filenames[i] );
+        if ( parsed[i]->tracks().empty() ) {
+          parsed[i].reset();
+          lock_guard<mutex> lock { report_mutex };
+          cerr << filenames[i] << ": no tracks found; skipping\n";
+        }
+      } catch ( const exception& e ) {
+        lock_guard<mutex> lock { report_mutex };
+        cerr << filenames[i] << ": " << e.what() << "; skipping\n";
+      }
+    }
+  };
+
+  const uint64_t start = Timer::timestamp_ns();
+
+  vector<thread> workers;
+  const size_t worker_count = clamp<size_t>( thread::hardware_concurrency(), 1, max<size_t>( parsed.size(), 1 ) );
+  for ( size_t i = 0; i < worker_count; i++ ) {
+    workers.emplace_back( parse_worker );
+  }
+
+  for ( auto& worker : workers ) {
+    worker.join();
+  }
+
+  for ( auto& file : parsed ) {
+    if ( file ) {
+      files_.push_back( move( *file ) );
+    }
+  }
+
+  cerr << "Parsed " << files_.size() << " of " << filenames.size() << " MIDI files using " << worker_count
+       << " threads in ";
+  Timer::pp_ns( cerr, Timer::timestamp_ns() - start );
+  cerr << ".\n";
+
+  size_t columns = 0, runs = 0, bytes = 0;
+  for ( const auto& file : files_ ) {
+    columns += file.piano_roll().size();
+    runs += file.piano_roll().num_runs();
+    bytes += file.piano_roll().memory_usage();
+  }
+  cerr << "Piano rolls: " << columns << " columns in " << runs << " runs, " << bytes / 1024 << " KiB ("
+       << columns * sizeof( PianoRollColumn<128> ) / 1024 << " KiB unpacked).\n";
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "midi_file.hh"
+
+#include <string>
+#include <vector>
+
+// Every MIDI file (".mid") in a directory, parsed on every core. Files that fail to parse, or
+// that have no tracks, are reported and skipped.
+class MidiCorpus
+{
+  std::vector<MidiFile> files_ {};
+
+public:
+  explicit MidiCorpus( const std::string& directory );
+
+  const std::vector<MidiFile>& files() const { return files_; }
+  size_t size() const { return files_.size(); }
+  bool empty() const { return files_.empty(); }
+
+  const MidiFile& operator[]( const size_t i ) const { return files_[i]; }
+};
@@ -1,16 +1,19 @@
 #pragma once
 #include "exception.hh"
-#include "file_descriptor.hh"
+#include "mmap.hh"
+#include "parser.hh"
 #include "piano_roll.hh"
 
 #include <algorithm>
 #include <array>
-#include <assert.h>
-#include <deque>
-#include <fcntl.h>
+#include <cstring>
 #include <iostream>
 #include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <tuple>
 #include <vector>
 
 struct MidiEvent
@@ -56,164 +59,107 @@ struct MidiEvent
   std::optional<uint32_t> tempo = std::nullopt;
   std::vector<uint8_t> data {};
 
-  template<class T>
-  T read_one( const std::string_view filename, const int fd )
+  static uint8_t read_byte( Parser& parser )
   {
-    char value[sizeof( T )];
-    static_assert( std::is_fundamental<T>::value, "can only read primitive types" );
-    size_t bytes = CheckSystemCall( filename, read( fd, &value, sizeof( T ) ) );
-    if ( bytes != sizeof( T ) ) {
-      throw unix_error( "read the wrong number of bytes" );
-    }
-    std::reverse( value, value + sizeof( T ) );
-    return *reinterpret_cast<T*>( value );
-  }
-
-  template<class T, size_t N>
-  std::array<T, N> read_several( const std::string_view filename, const int fd )
-  {
-    std::array<T, N> values {};
-    for ( size_t i = 0; i < N; i++ ) {
-      values[i] = read_one<T>( filename, fd );
-    }
-    return values;
+    uint8_t value;
+    parser.integer( value );
+    return value;
   }
 
-  uint32_t read_variable_length_int( const std::string_view filename, const int fd )
+  static uint32_t read_variable_length_int( Parser& parser )
   {
     uint32_t value = 0;
-    bool high_bit;
-    do {
-      value <<= 7;
-      uint8_t next_value = read_one<uint8_t>( filename, fd );
-      high_bit = next_value & 0x80;
-      value |= next_value & 0x7F;
-    } while ( high_bit );
-    return value;
+    for ( size_t i = 0; i < 4; i++ ) {
+      const uint8_t next_value = read_byte( parser );
+      value = ( value << 7 ) | ( next_value & 0x7F );
+      if ( not( next_value & 0x80 ) ) {
+        return value;
+      }
+    }
+    throw std::runtime_error( "MIDI variable-length quantity is too long" );
   }
 
-  MidiEvent( const std::string_view filename, int fd )
-    : ticks( read_variable_length_int( filename, fd ) )
-    , event_type( static_cast<EventType>( read_one<uint8_t>( filename, fd ) ) )
+  /* read one event from a track; `running_status` is the track's last channel-message status */
+  MidiEvent( Parser& parser, std::optional<EventType>& running_status )
+    : ticks( read_variable_length_int( parser ) )
+    , event_type( static_cast<EventType>( read_byte( parser ) ) )
   {
-    static std::optional<EventType> last_status = std::nullopt;
-    if ( event_type == 0xFF ) {
-      meta_event_type = static_cast<MetaEventType>( read_one<uint8_t>( filename, fd ) );
-      uint8_t length;
-      switch ( *meta_event_type ) {
-        case SequenceNumber:
-          length = 4;
-          break;
-        case Channel:
-          length = 2;
-          break;
-        case EndOfTrack:
-          length = 1;
-          break;
-        case Tempo:
-          tempo = read_one<uint32_t>( filename, fd ) & 0xffffff;
-          length = 0;
-          break;
-        case SmpteOffset:
-          length = 6;
-          break;
-        case TimeSignature:
-          length = 5;
-          break;
-        case KeySignature:
-          length = 3;
-          break;
-        default:
-          length = read_variable_length_int( filename, fd );
-      }
-      for ( size_t i = 0; i < length; i++ ) {
-        data.push_back( read_one<uint8_t>( filename, fd ) );
+    if ( event_type == MetaEvent ) {
+      meta_event_type = static_cast<MetaEventType>( read_byte( parser ) );
+      read_data( parser );
+      if ( meta_event_type == Tempo ) {
+        if ( data.size() < 3 ) {
+          throw std::runtime_error( "MIDI tempo event is too short" );
+        }
+        tempo = ( uint32_t( data[0] ) << 16 ) | ( uint32_t( data[1] ) << 8 ) | data[2];
       }
-      last_status = std::nullopt;
+      running_status = std::nullopt;
     } else if ( ( event_type & 0xF0 ) == 0xF0 ) {
       // SysEx
-      uint8_t length = read_variable_length_int( filename, fd );
-      for ( size_t i = 0; i < length; i++ ) {
-        data.push_back( read_one<uint8_t>( filename, fd ) );
-      }
-      last_status = std::nullopt;
-    } else if ( event_type & 0x80 or last_status.has_value() ) {
+      read_data( parser );
+      running_status = std::nullopt;
+    } else if ( event_type & 0x80 or running_status.has_value() ) {
       // MIDI
       uint8_t arg0;
       if ( event_type & 0x80 ) {
-        arg0 = read_one<uint8_t>( filename, fd );
+        arg0 = read_byte( parser );
       } else {
         arg0 = event_type;
-        event_type = *last_status;
+        event_type = *running_status;
       }
-      uint8_t masked = event_type & 0xf0;
-      if ( masked == EventType::NoteOn or masked == EventType::NoteOff
-           or masked == EventType::PolyphonicKeyPressure ) {
-        key = arg0;
-        velocity = read_one<uint8_t>( filename, fd );
-      } else if ( masked == EventType::ControlChange ) {
-        read_one<uint8_t>( filename, fd );
-      } else if ( masked == EventType::ProgramChange ) {
-      } else {
-        throw std::runtime_error( "Unhandled MIDI event type" );
+      switch ( event_type & 0xF0 ) {
+        case NoteOff:
+        case NoteOn:
+        case PolyphonicKeyPressure:
+          if ( arg0 & 0x80 ) {
+            throw std::runtime_error( "Invalid key in MIDI note event" );
+          }
+          key = arg0;
+          velocity = read_byte( parser );
+          break;
+        case ControlChange:
+        case PitchWheelChange:
+          read_byte( parser );
+          break;
+        default:
+          // ProgramChange and ChannelPressure have a single data byte
+          break;
       }
-      last_status = event_type;
+      running_status = event_type;
       channel = event_type & 0xf;
       event_type = static_cast<EventType>( event_type & 0xf0 );
     } else {
       throw std::runtime_error( "MIDI file out of sync" );
     }
   }
-};
 
-class MidiTrack
-{
 private:
-  template<class T>
-  T read_one( const std::string_view filename, const int fd )
-  {
-    char value[sizeof( T )];
-    static_assert( std::is_fundamental<T>::value, "can only read primitive types" );
-    size_t bytes = CheckSystemCall( filename, read( fd, &value, sizeof( T ) ) );
-    if ( bytes != sizeof( T ) ) {
-      throw unix_error( "read the wrong number of bytes" );
-    }
-    std::reverse( value, value + sizeof( T ) );
-    return *reinterpret_cast<T*>( value );
-  }
-
-  template<class T, size_t N>
-  std::array<T, N> read_several( const std::string_view filename, const int fd )
+  void read_data( Parser& parser )
   {
-    std::array<T, N> values {};
-    for ( size_t i = 0; i < N; i++ ) {
-      values[i] = read_one<T>( filename, fd );
-    }
-    return values;
+    const std::string_view bytes = parser.bytes( read_variable_length_int( parser ) );
+    data.assign( bytes.begin(), bytes.end() );
   }
+};
 
+class MidiTrack
+{
+private:
   std::vector<MidiEvent> events_ {};
   std::optional<uint32_t> starting_tempo_ = std::nullopt;
 
 public:
-  MidiTrack( const std::string_view filename, int fd )
+  /* parse the body of an MTrk chunk */
+  explicit MidiTrack( const std::string_view chunk )
   {
-    char magic[4];
-    memcpy( &magic, read_several<char, 4>( filename, fd ).data(), 4 );
-    if ( memcmp( magic, "MTrk", 4 ) ) {
-      throw std::runtime_error( "Invalid magic number in MIDI track" );
-    }
-    uint32_t nbytes = read_one<uint32_t>( filename, fd );
-    off_t start_offset = CheckSystemCall( filename, lseek( fd, 0, SEEK_CUR ) );
-    off_t current_offset = CheckSystemCall( filename, lseek( fd, 0, SEEK_CUR ) );
-    while ( current_offset < start_offset + nbytes ) {
-      MidiEvent event( filename, fd );
+    Parser parser { chunk };
+    std::optional<MidiEvent::EventType> running_status = std::nullopt;
+    while ( not parser.input().empty() ) {
+      MidiEvent event( parser, running_status );
       if ( ( not starting_tempo_.has_value() ) and event.event_type == MidiEvent::MetaEvent
            and event.meta_event_type == MidiEvent::Tempo ) {
         starting_tempo_ = event.tempo;
       }
-      events_.push_back( event );
-      current_offset = CheckSystemCall( filename, lseek( fd, 0, SEEK_CUR ) );
+      events_.push_back( std::move( event ) );
     }
   }
 
@@ -235,90 +181,99 @@ private:
   MidiHeader header_ {};
   std::vector<MidiEvent> events_ {};
   std::vector<MidiTrack> tracks_ {};
-  PianoRoll<128> piano_roll_ {};
+  PackedPianoRoll piano_roll_ {};
   std::vector<float> time_in_beats_ {};
   std::vector<uint32_t> periods_ {};
   std::optional<uint32_t> starting_tempo_ = std::nullopt;
 
-  template<class T>
-  T read_one( const std::string_view filename, const int fd )
-  {
-    char value[sizeof( T )];
-    static_assert( std::is_fundamental<T>::value, "can only read primitive types" );
-    size_t bytes = CheckSystemCall( filename, read( fd, &value, sizeof( T ) ) );
-    if ( bytes != sizeof( T ) ) {
-      throw unix_error( "read the wrong number of bytes" );
-    }
-    std::reverse( value, value + sizeof( T ) );
-    return *reinterpret_cast<T*>( value );
-  }
-
-  template<class T, size_t N>
-  std::array<T, N> read_several( const std::string_view filename, const int fd )
-  {
-    std::array<T, N> values {};
-    for ( size_t i = 0; i < N; i++ ) {
-      values[i] = read_one<T>( filename, fd );
-    }
-    return values;
-  }
-
 public:
   const std::string name;
 
-  MidiFile( const std::string filename )
+  /* `diagnostics`, if given, gets a line (beat, tempo and velocity) for each new NoteOn time */
+  MidiFile( const std::string filename, std::ostream* diagnostics = nullptr )
+    : MidiFile( filename, ReadOnlyFile { filename }, diagnostics )
+  {}
+
+  /* parse a Standard MIDI File that is already in memory (e.g. a ReadOnlyFile) */
+  MidiFile( const std::string& filename, const std::string_view contents, std::ostream* diagnostics = nullptr )
     : name( filename )
   {
     using namespace std;
-    int fd = CheckSystemCall( filename, open( filename.c_str(), O_RDONLY ) );
-    memcpy( header_.magic, read_several<char, 4>( filename, fd ).data(), 4 );
-    header_.header_length = read_one<uint32_t>( filename, fd );
-    header_.format = read_one<uint16_t>( filename, fd );
-    header_.track_count = read_one<uint16_t>( filename, fd );
-    header_.ticks_per_beat = read_one<int16_t>( filename, fd );
+    Parser parser { contents };
+    memcpy( header_.magic, parser.bytes( 4 ).data(), 4 );
+    parser.integer( header_.header_length );
 
     if ( memcmp( header_.magic, "MThd", 4 ) ) {
       throw runtime_error( "Invalid magic number in MIDI header" );
     }
 
+    if ( header_.header_length < 6 ) {
+      throw runtime_error( "Invalid header length in MIDI header" );
+    }
+
+    parser.integer( header_.format );
+    parser.integer( header_.track_count );
+    parser.integer( header_.ticks_per_beat );
+    parser.bytes( header_.header_length - 6 );
+
     if ( header_.ticks_per_beat <= 0 ) {
       throw runtime_error( "Invalid ticks per beat in MIDI header" );
     }
 
-    off_t current = CheckSystemCall( filename, lseek( fd, 0, SEEK_CUR ) );
-    off_t end = CheckSystemCall( filename, lseek( fd, 0, SEEK_END ) );
-    CheckSystemCall( filename, lseek( fd, current, SEEK_SET ) );
+    while ( not parser.input().empty() ) {
+      const string_view chunk_type = parser.bytes( 4 );
+      uint32_t chunk_length;
+      parser.integer( chunk_length );
+      const string_view chunk = parser.bytes( chunk_length );
 
-    while ( current < end ) {
-      tracks_.push_back( MidiTrack( filename, fd ) );
-      current = CheckSystemCall( filename, lseek( fd, 0, SEEK_CUR ) );
+      // chunks of other types are allowed, and are to be ignored
+      if ( chunk_type == "MTrk" ) {
+        tracks_.emplace_back( chunk );
+      }
     }
 
     // the MIDI file separates events into tracks, but we want to reintegrate
-    // all of them into a single stream
-    std::vector<std::deque<MidiEvent>> tracks {};
-
-    for ( const auto& track : tracks_ ) {
-      std::deque events( track.events().begin(), track.events().end() );
-      tracks.push_back( events );
+    // all of them into a single stream. Each track's next event waits in a heap, ordered by its
+    // absolute time (ties go to the earlier track).
+    struct NextEvent
+    {
+      uint64_t ticks;
+      size_t track;
+      size_t index;
+
+      bool operator>( const NextEvent& other ) const
+      {
+        return tie( ticks, track ) > tie( other.ticks, other.track );
+      }
+    };
+    priority_queue<NextEvent, vector<NextEvent>, greater<NextEvent>> next_events {};
+
+    size_t event_count = 0;
+    for ( size_t i = 0; i < tracks_.size(); i++ ) {
+      const auto& events = tracks_[i].events();
+      if ( not events.empty() ) {
+        next_events.push( { events.front().ticks, i, 0 } );
+      }
+      event_count += events.size();
     }
+    events_.reserve( event_count );
 
-    // Keep advancing time to the next event we can see in any channel
-    float current_time = 0;
+    uint64_t previous_ticks = 0;
     uint32_t current_tempo = 0;
-    while ( not tracks.empty() ) {
-      size_t min_idx = 0;
-      for ( size_t i = 0; i < tracks.size(); i++ ) {
-        if ( tracks.at( i ).front().ticks < tracks.at( min_idx ).front().ticks ) {
-          min_idx = i;
-        }
+    while ( not next_events.empty() ) {
+      const NextEvent next = next_events.top();
+      next_events.pop();
+
+      const auto& track = tracks_[next.track].events();
+      if ( next.index + 1 < track.size() ) {
+        next_events.push( { next.ticks + track[next.index + 1].ticks, next.track, next.index + 1 } );
       }
-      current_time += tracks.at( min_idx ).front().ticks / (float)header_.ticks_per_beat;
-      std::deque<MidiEvent>& track = tracks.at( min_idx );
-      MidiEvent& event = track.front();
-      if ( event.event_type == 0x80 or event.event_type == 0x90 ) {}
-      size_t ticks = event.ticks;
-      events_.push_back( event );
+
+      // in the merged stream, an event's ticks are the time since the previous event
+      MidiEvent& event = events_.emplace_back( track[next.index] );
+      event.ticks = next.ticks - previous_ticks;
+      previous_ticks = next.ticks;
+      const float current_time = next.ticks / (float)header_.ticks_per_beat;
 
       // tempo change
       if ( event.event_type == 0xFF and event.meta_event_type.value() == 0x51 ) {
@@ -331,24 +286,16 @@ public:
         if ( time_in_beats_.size() == 0 or time_in_beats_.back() != current_time ) {
           time_in_beats_.push_back( current_time );
           periods_.push_back( current_tempo );
-          cout << current_time << "\t\t\t" << current_tempo << "\t\t" << unsigned( event.velocity.value() ) << endl;
+          if ( diagnostics ) {
+            *diagnostics << current_time << "\t\t\t" << current_tempo << "\t\t"
+                         << unsigned( event.velocity.value() ) << "\n";
+          }
         }
       }
-
-      for ( std::deque<MidiEvent>& t : tracks ) {
-        t.front().ticks -= ticks;
-      }
-      track.pop_front();
-
-      if ( track.empty() ) {
-        tracks.erase( tracks.begin() + min_idx );
-      }
     }
 
-    piano_roll_.push_back( {} );
-    for ( size_t i = 0; i < piano_roll_.back().size(); i++ ) {
-      piano_roll_.back()[i] = PianoRollEvent::Unknown;
-    }
+    // the column being filled in; it is appended to the roll once time moves past it
+    PackedPianoRollColumn column {};
     size_t ticks_per_piano_roll = header_.ticks_per_beat / 4;
     size_t ticks_in_current_timeslot = ticks_per_piano_roll / 2;
     bool have_any_notes = false;
@@ -362,27 +309,27 @@ public:
       if ( ticks_in_current_timeslot >= ticks_per_piano_roll ) {
         size_t rolls = ticks_in_current_timeslot / ticks_per_piano_roll;
         ticks_in_current_timeslot %= ticks_per_piano_roll;
-        for ( size_t i = 0; i < rolls; i++ ) {
-          piano_roll_.push_back( piano_roll_.back() );
-        }
+        piano_roll_.push_back( column, rolls );
       }
       MidiEvent::EventType type = event.event_type;
       if ( type == MidiEvent::NoteOn and event.velocity > 0 ) {
-        piano_roll_.back()[*event.key] = PianoRollEvent::NoteDown;
+        column.set( *event.key, true );
         have_any_notes = true;
       } else if ( type == MidiEvent::NoteOff or ( type == MidiEvent::NoteOn and event.velocity == 0 ) ) {
-        piano_roll_.back()[*event.key] = PianoRollEvent::NoteUp;
+        column.set( *event.key, false );
         have_any_notes = true;
       }
       ++iter;
     }
+    piano_roll_.push_back( column );
+    piano_roll_.shrink_to_fit();
   }
 
   size_t ticks_per_beat() const { return header_.ticks_per_beat; };
   const std::vector<MidiTrack>& tracks() const { return tracks_; }
   const std::vector<MidiEvent>& events() const { return events_; }
   std::optional<uint32_t> starting_tempo() const { return starting_tempo_; };
-  const PianoRoll<128>& piano_roll() const { return piano_roll_; };
+  const PackedPianoRoll& piano_roll() const { return piano_roll_; };
   const std::vector<float>& time_in_beats() const { return time_in_beats_; };
   const std::vector<uint32_t>& periods() const { return periods_; };
 };
@@ -0,0 +1,363 @@
+#include "mix_kernels.hh"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+#include <immintrin.h>
+#elif defined( __ARM_NEON ) && defined( __aarch64__ )
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+/* largest float that still fits in an int32 after scaling, and the scale itself */
+constexpr float SAMPLE_SCALE = uint64_t( 1 ) << 31;
+constexpr float SAMPLE_MAX = 2147483520.0f;
+
+int32_t to_sample( const float sample )
+{
+  return lrint( min( clamp( sample, -1.0f, 1.0f ) * SAMPLE_SCALE, SAMPLE_MAX ) );
+}
+
+static_assert( sizeof( MixKernels::StereoFrame ) == 2 * sizeof( float ) );
+
+float* floats( MixKernels::StereoFrame* frames )
+{
+  return &frames->first;
+}
+
+const float* floats( const MixKernels::StereoFrame* frames )
+{
+  return &frames->first;
+}
+
+#if defined( __AVX2__ )
+struct Vector
+{
+  using T = __m256;
+  static constexpr size_t width = 8;
+  static constexpr const char* name = "AVX2";
+
+  static T load( const float* p ) { return _mm256_loadu_ps( p ); }
+  static void store( float* p, const T v ) { _mm256_storeu_ps( p, v ); }
+  static T set1( const float x ) { return _mm256_set1_ps( x ); }
+  static T add( const T a, const T b ) { return _mm256_add_ps( a, b ); }
+  static T mul( const T a, const T b ) { return _mm256_mul_ps( a, b ); }
+  static T min( const T a, const T b ) { return _mm256_min_ps( a, b ); }
+  static T max( const T a, const T b ) { return _mm256_max_ps( a, b ); }
+
+  // the frame index of each lane, with both channels of a frame sharing an index
+  static T frame_index() { return _mm256_setr_ps( 0, 0, 1, 1, 2, 2, 3, 3 ); }
+
+  // (l0..l7, r0..r7) -> (l0, r0, .., l3, r3), (l4, r4, .., l7, r7)
+  static void interleave( const T l, const T r, T& first, T& second )
+  {
+    const T lo = _mm256_unpacklo_ps( l, r );
+    const T hi = _mm256_unpackhi_ps( l, r );
+    first = _mm256_permute2f128_ps( lo, hi, 0x20 );
+    second = _mm256_permute2f128_ps( lo, hi, 0x31 );
+  }
+
+  static void store_int32( int32_t* p, const T v )
+  {
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( p ), _mm256_cvtps_epi32( v ) );
+  }
+};
+#elif defined( __SSE2__ )
+struct Vector
+{
+  using T = __m128;
+  static constexpr size_t width = 4;
+  static constexpr const char* name = "SSE2";
+
+  static T load( const float* p ) { return _mm_loadu_ps( p ); }
+  static void store( float* p, const T v ) { _mm_storeu_ps( p, v ); }
+  static T set1( const float x ) { return _mm_set1_ps( x ); }
+  static T add( const T a, const T b ) { return _mm_add_ps( a, b ); }
+  static T mul( const T a, const T b ) { return _mm_mul_ps( a, b ); }
+  static T min( const T a, const T b ) { return _mm_min_ps( a, b ); }
+  static T max( const T a, const T b ) { return _mm_max_ps( a, b ); }
+
+  static T frame_index() { return _mm_setr_ps( 0, 0, 1, 1 ); }
+
+  static void interleave( const T l, const T r, T& first, T& second )
+  {
+    first = _mm_unpacklo_ps( l, r );
+    second = _mm_unpackhi_ps( l, r );
+  }
+
+  static void store_int32( int32_t* p, const T v )
+  {
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( p ), _mm_cvtps_epi32( v ) );
+  }
+};
+#elif defined( __ARM_NEON ) && defined( __aarch64__ )
+struct Vector
+{
+  using T = float32x4_t;
+  static constexpr size_t width = 4;
+  static constexpr const char* name = "NEON";
+
+  static T load( const float* p ) { return vld1q_f32( p ); }
+  static void store( float* p, const T v ) { vst1q_f32( p, v ); }
+  static T set1( const float x ) { return vdupq_n_f32( x ); }
+  static T add( const T a, const T b ) { return vaddq_f32( a, b ); }
+  static T mul( const T a, const T b ) { return vmulq_f32( a, b ); }
+  static T min( const T a, const T b ) { return vminq_f32( a, b ); }
+  static T max( const T a, const T b ) { return vmaxq_f32( a, b ); }
+
+  static T frame_index()
+  {
+    static constexpr float index[4] = { 0, 0, 1, 1 };
+    return vld1q_f32( index );
+  }
+
+  static void interleave( const T l, const T r, T& first, T& second )
+  {
+    first = vzip1q_f32( l, r );
+    second = vzip2q_f32( l, r );
+  }
+
+  static void store_int32( int32_t* p, const T v ) { vst1q_s32( p, vcvtnq_s32_f32( v ) ); }
+};
+#endif
+
+}
+
+namespace MixKernels::Scalar {
+
+void mix( StereoFrame* dest, const StereoFrame* src, const float gain, const size_t frames )
+{
+  float* d = floats( dest );
+  const float* s = floats( src );
+  for ( size_t i = 0; i < 2 * frames; i++ ) {
+    d[i] += s[i] * gain;
+  }
+}
+
+void crossfade( StereoFrame* dest,
+                const StereoFrame* a,
+                const float a_gain,
+                const StereoFrame* b,
+                const float b_gain,
+                const size_t frames )
+{
+  float* d = floats( dest );
+  const float* fa = floats( a );
+  const float* fb = floats( b );
+  for ( size_t i = 0; i < 2 * frames; i++ ) {
+    d[i] += fa[i] * a_gain + fb[i] * b_gain;
+  }
+}
+
+void crossfade_ramp( StereoFrame* dest,
+                     const StereoFrame* a,
+                     const float a_gain,
+                     const StereoFrame* b,
+                     const float b_gain,
+                     const float ramp_start,
+                     const float ramp_step,
+                     const size_t frames )
+{
+  for ( size_t i = 0; i < frames; i++ ) {
+    const float ratio = ramp_start + i * ramp_step;
+    dest[i].first += ( a[i].first * a_gain + b[i].first * b_gain ) * ratio;
+    dest[i].second += ( a[i].second * a_gain + b[i].second * b_gain ) * ratio;
+  }
+}
+
+void to_int32( int32_t* dest, const StereoFrame* src, const size_t frames )
+{
+  const float* s = floats( src );
+  for ( size_t i = 0; i < 2 * frames; i++ ) {
+    dest[i] = to_sample( s[i] );
+  }
+}
+
+void planar_to_int32( int32_t* dest, const float* left, const float* right, const size_t frames )
+{
+  for ( size_t i = 0; i < frames; i++ ) {
+    dest[2 * i] = to_sample( left[i] );
+    dest[2 * i + 1] = to_sample( right[i] );
+  }
+}
+
+}
+
+namespace MixKernels {
+
+#if defined( __AVX2__ ) || defined( __SSE2__ ) || ( defined( __ARM_NEON ) && defined( __aarch64__ ) )
+
+/* vector loops cover whole vectors; the scalar kernels finish the last few frames */
+static constexpr size_t frames_per_vector = Vector::width / 2;
+
+const char* instruction_set()
+{
+  return Vector::name;
+}
+
+void mix( StereoFrame* dest, const StereoFrame* src, const float gain, const size_t frames )
+{
+  float* d = floats( dest );
+  const float* s = floats( src );
+  const auto g = Vector::set1( gain );
+
+  size_t frame = 0;
+  for ( ; frame + frames_per_vector <= frames; frame += frames_per_vector ) {
+    const size_t i = 2 * frame;
+    Vector::store( d + i, Vector::add( Vector::load( d + i ), Vector::mul( Vector::load( s + i ), g ) ) );
+  }
+
+  Scalar::mix( dest + frame, src + frame, gain, frames - frame );
+}
+
+void crossfade( StereoFrame* dest,
+                const StereoFrame* a,
+                const float a_gain,
+                const StereoFrame* b,
+                const float b_gain,
+                const size_t frames )
+{
+  float* d = floats( dest );
+  const float* fa = floats( a );
+  const float* fb = floats( b );
+  const auto ga = Vector::set1( a_gain );
+  const auto gb = Vector::set1( b_gain );
+
+  size_t frame = 0;
+  for ( ; frame + frames_per_vector <= frames; frame += frames_per_vector ) {
+    const size_t i = 2 * frame;
+    const auto mixed = Vector::add( Vector::mul( Vector::load( fa + i ), ga ), Vector::mul( Vector::load( fb + i ), gb ) );
+    Vector::store( d + i, Vector::add( Vector::load( d + i ), mixed ) );
+  }
+
+  Scalar::crossfade( dest + frame, a + frame, a_gain, b + frame, b_gain, frames - frame );
+}
+
+void crossfade_ramp( StereoFrame* dest,
+                     const StereoFrame* a,
+                     const float a_gain,
+                     const StereoFrame* b,
+                     const float b_gain,
+                     const float ramp_start,
+                     const float ramp_step,
+                     const size_t frames )
+{
+  float* d = floats( dest );
+  const float* fa = floats( a );
+  const float* fb = floats( b );
+  const auto ga = Vector::set1( a_gain );
+  const auto gb = Vector::set1( b_gain );
+  const auto step = Vector::set1( ramp_step );
+  const auto lane_offsets = Vector::mul( Vector::frame_index(), step );
+
+  size_t frame = 0;
+  for ( ; frame + frames_per_vector <= frames; frame += frames_per_vector ) {
+    const size_t i = 2 * frame;
+    const auto ratio = Vector::add( Vector::set1( ramp_start + frame * ramp_step ), lane_offsets );
+    const auto mixed = Vector::add( Vector::mul( Vector::load( fa + i ), ga ), Vector::mul( Vector::load( fb + i ), gb ) );
+    Vector::store( d + i, Vector::add( Vector::load( d + i ), Vector::mul( mixed, ratio ) ) );
+  }
+
+  Scalar::crossfade_ramp( dest + frame,
+                          a + frame,
+                          a_gain,
+                          b + frame,
+                          b_gain,
+                          ramp_start + frame * ramp_step,
+                          ramp_step,
+                          frames - frame );
+}
+
+void to_int32( int32_t* dest, const StereoFrame* src, const size_t frames )
+{
+  const float* s = floats( src );
+  const auto lower = Vector::set1( -1.0f );
+  const auto upper = Vector::set1( 1.0f );
+  const auto scale = Vector::set1( SAMPLE_SCALE );
+  const auto sample_max = Vector::set1( SAMPLE_MAX );
+
+  size_t frame = 0;
+  for ( ; frame + frames_per_vector <= frames; frame += frames_per_vector ) {
+    const size_t i = 2 * frame;
+    const auto clamped = Vector::min( Vector::max( Vector::load( s + i ), lower ), upper );
+    Vector::store_int32( dest + i, Vector::min( Vector::mul( clamped, scale ), sample_max ) );
+  }
+
+  Scalar::to_int32( dest + 2 * frame, src + frame, frames - frame );
+}
+
+void planar_to_int32( int32_t* dest, const float* left, const float* right, const size_t frames )
+{
+  const auto lower = Vector::set1( -1.0f );
+  const auto upper = Vector::set1( 1.0f );
+  const auto scale = Vector::set1( SAMPLE_SCALE );
+  const auto sample_max = Vector::set1( SAMPLE_MAX );
+
+  auto convert = [&]( const float* p ) {
+    const auto clamped = Vector::min( Vector::max( Vector::load( p ), lower ), upper );
+    return Vector::min( Vector::mul( clamped, scale ), sample_max );
+  };
+
+  /* each iteration takes a full vector from both channels */
+  size_t frame = 0;
+  for ( ; frame + Vector::width <= frames; frame += Vector::width ) {
+    Vector::T first, second;
+    Vector::interleave( convert( left + frame ), convert( right + frame ), first, second );
+    Vector::store_int32( dest + 2 * frame, first );
+    Vector::store_int32( dest + 2 * frame + Vector::width, second );
+  }
+
+  Scalar::planar_to_int32( dest + 2 * frame, left + frame, right + frame, frames - frame );
+}
+
+#else
+
+const char* instruction_set()
+{
+  return "scalar";
+}
+
+void mix( StereoFrame* dest, const StereoFrame* src, const float gain, const size_t frames )
+{
+  Scalar::mix( dest, src, gain, frames );
+}
+
+void crossfade( StereoFrame* dest,
+                const StereoFrame* a,
+                const float a_gain,
+                const StereoFrame* b,
+                const float b_gain,
+                const size_t frames )
+{
+  Scalar::crossfade( dest, a, a_gain, b, b_gain, frames );
+}
+
+void crossfade_ramp( StereoFrame* dest,
+                     const StereoFrame* a,
+                     const float a_gain,
+                     const StereoFrame* b,
+                     const float b_gain,
+                     const float ramp_start,
+                     const float ramp_step,
+                     const size_t frames )
+{
+  Scalar::crossfade_ramp( dest, a, a_gain, b, b_gain, ramp_start, ramp_step, frames );
+}
+
+void to_int32( int32_t* dest, const StereoFrame* src, const size_t frames )
+{
+  Scalar::to_int32( dest, src, frames );
+}
+
+void planar_to_int32( int32_t* dest, const float* left, const float* right, const size_t frames )
+{
+  Scalar::planar_to_int32( dest, left, right, frames );
+}
+
+#endif
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Mixing kernels for interleaved stereo float frames (left, right, left, right, ...).
+// Each kernel has a vector implementation chosen at compile time (AVX2, SSE2 or NEON)
+// and a scalar fallback; the scalar versions are also exposed for testing.
+
+namespace MixKernels {
+
+using StereoFrame = std::pair<float, float>;
+
+// Name of the instruction set the kernels were compiled for
+const char* instruction_set();
+
+// dest[i] += src[i] * gain
+void mix( StereoFrame* dest, const StereoFrame* src, const float gain, const size_t frames );
+
+// dest[i] += a[i] * a_gain + b[i] * b_gain
+void crossfade( StereoFrame* dest,
+                const StereoFrame* a,
+                const float a_gain,
+                const StereoFrame* b,
+                const float b_gain,
+                const size_t frames );
+
+// dest[i] += ( a[i] * a_gain + b[i] * b_gain ) * ( ramp_start + i * ramp_step )
+void crossfade_ramp( StereoFrame* dest,
+                     const StereoFrame* a,
+                     const float a_gain,
+                     const StereoFrame* b,
+                     const float b_gain,
+                     const float ramp_start,
+                     const float ramp_step,
+                     const size_t frames );
+
+// Clamp to [-1, 1] and convert to full-scale signed 32-bit samples (still interleaved)
+void to_int32( int32_t* dest, const StereoFrame* src, const size_t frames );
+
+// Same, from separate left and right channels into interleaved samples
+void planar_to_int32( int32_t* dest, const float* left, const float* right, const size_t frames );
+
+namespace Scalar {
+void mix( StereoFrame* dest, const StereoFrame* src, const float gain, const size_t frames );
+void crossfade( StereoFrame* dest,
+                const StereoFrame* a,
+                const float a_gain,
+                const StereoFrame* b,
+                const float b_gain,
+                const size_t frames );
+void crossfade_ramp( StereoFrame* dest,
+                     const StereoFrame* a,
+                     const float a_gain,
+                     const StereoFrame* b,
+                     const float b_gain,
+                     const float ramp_start,
+                     const float ramp_step,
+                     const size_t frames );
+void to_int32( int32_t* dest, const StereoFrame* src, const size_t frames );
+void planar_to_int32( int32_t* dest, const float* left, const float* right, const size_t frames );
+}
+
+}
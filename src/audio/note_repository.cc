@@ -1,8 +1,19 @@
 #include "note_repository.hh"
+#include "exception.hh"
+#include "parser.hh"
+#include "timer.hh"
 #include "wav_wrapper.hh"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 
@@ -11,206 +22,307 @@ constexpr float LOW_XFOUT_HIVEL = 59;  // Equivalent to MED_XFIN_HIVEL
 constexpr float HIGH_XFIN_LOVEL = 67;  // Equivalent to MED_XFOUT_LOVEL
 constexpr float HIGH_XFIN_HIVEL = 119; // Equivalent to MED_XFOUT_HIVEL
 
-NoteRepository::NoteRepository( const string& sample_directory )
+/* Sample bank layout: magic, version and note count, then the byte offset and frame count of
+   every note's layers (integers big-endian, as with Serializer). The samples follow as native
+   floats, each layer starting on a BANK_ALIGNMENT boundary so it can be used in place. */
+constexpr string_view BANK_MAGIC = "SMPLBANK";
+constexpr uint32_t BANK_VERSION = 1;
+constexpr size_t BANK_ALIGNMENT = 64;
+
+/* samples quieter than this (-120 dBFS) at the end of a recording are dropped */
+constexpr float SILENCE_THRESHOLD = 1e-6;
+
+/* every note's sample file prefix, in key order */
+struct NoteName
 {
-  add_notes( sample_directory, "A0" );
-  add_notes( sample_directory, "U-A0" );
-  add_notes( sample_directory, "D-C1" );
-  add_notes( sample_directory, "C1" );
-  add_notes( sample_directory, "U-C1" );
-  add_notes( sample_directory, "D-D#1" );
-  add_notes( sample_directory, "D#1" );
-  add_notes( sample_directory, "U-D#1" );
-  add_notes( sample_directory, "D-F#1" );
-  add_notes( sample_directory, "F#1" );
-  add_notes( sample_directory, "U-F#1" );
-  add_notes( sample_directory, "D-A1" );
-  add_notes( sample_directory, "A1" );
-  add_notes( sample_directory, "U-A1" );
-  add_notes( sample_directory, "D-C2" );
-  add_notes( sample_directory, "C2" );
-  add_notes( sample_directory, "U-C2" );
-  add_notes( sample_directory, "D-D#2" );
-  add_notes( sample_directory, "D#2" );
-  add_notes( sample_directory, "U-D#2" );
-  add_notes( sample_directory, "D-F#2" );
-  add_notes( sample_directory, "F#2" );
-  add_notes( sample_directory, "U-F#2" );
-  add_notes( sample_directory, "D-A2" );
-  add_notes( sample_directory, "A2" );
-  add_notes( sample_directory, "U-A2" );
-  add_notes( sample_directory, "D-C3" );
-  add_notes( sample_directory, "C3" );
-  add_notes( sample_directory, "U-C3" );
-  add_notes( sample_directory, "D-D#3" );
-  add_notes( sample_directory, "D#3" );
-  add_notes( sample_directory, "U-D#3" );
-  add_notes( sample_directory, "D-F#3" );
-  add_notes( sample_directory, "F#3" );
-  add_notes( sample_directory, "U-F#3" );
-  add_notes( sample_directory, "D-A3" );
-  add_notes( sample_directory, "A3" );
-  add_notes( sample_directory, "U-A3" );
-  add_notes( sample_directory, "D-C4" );
-  add_notes( sample_directory, "C4" );
-  add_notes( sample_directory, "U-C4" );
-  add_notes( sample_directory, "D-D#4" );
-  add_notes( sample_directory, "D#4" );
-  add_notes( sample_directory, "U-D#4" );
-  add_notes( sample_directory, "D-F#4" );
-  add_notes( sample_directory, "F#4" );
-  add_notes( sample_directory, "U-F#4" );
-  add_notes( sample_directory, "D-A4" );
-  add_notes( sample_directory, "A4" );
-  add_notes( sample_directory, "U-A4" );
-  add_notes( sample_directory, "D-C5" );
-  add_notes( sample_directory, "C5" );
-  add_notes( sample_directory, "U-C5" );
-  add_notes( sample_directory, "D-D#5" );
-  add_notes( sample_directory, "D#5" );
-  add_notes( sample_directory, "U-D#5" );
-  add_notes( sample_directory, "D-F#5" );
-  add_notes( sample_directory, "F#5" );
-  add_notes( sample_directory, "U-F#5" );
-  add_notes( sample_directory, "D-A5" );
-  add_notes( sample_directory, "A5" );
-  add_notes( sample_directory, "U-A5" );
-  add_notes( sample_directory, "D-C6" );
-  add_notes( sample_directory, "C6" );
-  add_notes( sample_directory, "U-C6" );
-  add_notes( sample_directory, "D-D#6" );
-  add_notes( sample_directory, "D#6" );
-  add_notes( sample_directory, "U-D#6" );
+  const char* name;
+  bool has_damper;
+};
+
+constexpr array<NoteName, 88> NOTE_NAMES { {
+  { "A0", true },
+  { "U-A0", true },
+  { "D-C1", true },
+  { "C1", true },
+  { "U-C1", true },
+  { "D-D#1", true },
+  { "D#1", true },
+  { "U-D#1", true },
+  { "D-F#1", true },
+  { "F#1", true },
+  { "U-F#1", true },
+  { "D-A1", true },
+  { "A1", true },
+  { "U-A1", true },
+  { "D-C2", true },
+  { "C2", true },
+  { "U-C2", true },
+  { "D-D#2", true },
+  { "D#2", true },
+  { "U-D#2", true },
+  { "D-F#2", true },
+  { "F#2", true },
+  { "U-F#2", true },
+  { "D-A2", true },
+  { "A2", true },
+  { "U-A2", true },
+  { "D-C3", true },
+  { "C3", true },
+  { "U-C3", true },
+  { "D-D#3", true },
+  { "D#3", true },
+  { "U-D#3", true },
+  { "D-F#3", true },
+  { "F#3", true },
+  { "U-F#3", true },
+  { "D-A3", true },
+  { "A3", true },
+  { "U-A3", true },
+  { "D-C4", true },
+  { "C4", true },
+  { "U-C4", true },
+  { "D-D#4", true },
+  { "D#4", true },
+  { "U-D#4", true },
+  { "D-F#4", true },
+  { "F#4", true },
+  { "U-F#4", true },
+  { "D-A4", true },
+  { "A4", true },
+  { "U-A4", true },
+  { "D-C5", true },
+  { "C5", true },
+  { "U-C5", true },
+  { "D-D#5", true },
+  { "D#5", true },
+  { "U-D#5", true },
+  { "D-F#5", true },
+  { "F#5", true },
+  { "U-F#5", true },
+  { "D-A5", true },
+  { "A5", true },
+  { "U-A5", true },
+  { "D-C6", true },
+  { "C6", true },
+  { "U-C6", true },
+  { "D-D#6", true },
+  { "D#6", true },
+  { "U-D#6", true },
   // keys below here do not have dampers
-  add_notes( sample_directory, "D-F#6", false );
-  add_notes( sample_directory, "F#6", false );
-  add_notes( sample_directory, "U-F#6", false );
-  add_notes( sample_directory, "D-A6", false );
-  add_notes( sample_directory, "A6", false );
-  add_notes( sample_directory, "U-A6", false );
-  add_notes( sample_directory, "D-C7", false );
-  add_notes( sample_directory, "C7", false );
-  add_notes( sample_directory, "U-C7", false );
-  add_notes( sample_directory, "D-D#7", false );
-  add_notes( sample_directory, "D#7", false );
-  add_notes( sample_directory, "U-D#7", false );
-  add_notes( sample_directory, "D-F#7", false );
-  add_notes( sample_directory, "F#7", false );
-  add_notes( sample_directory, "U-F#7", false );
-  add_notes( sample_directory, "D-A7", false );
-  add_notes( sample_directory, "A7", false );
-  add_notes( sample_directory, "U-A7", false );
-  add_notes( sample_directory, "D-C8", false );
-  add_notes( sample_directory, "C8", false );
-
-  cerr << "Added " << notes.size() << " notes\n";
-
-  size_t maximum_keydown_length {};
-  for ( const auto& x : notes ) {
-    maximum_keydown_length = max( maximum_keydown_length, x.getSlow().size() );
-    maximum_keydown_length = max( maximum_keydown_length, x.getMed().size() );
-    maximum_keydown_length = max( maximum_keydown_length, x.getFast().size() );
-  }
+  { "D-F#6", false },
+  { "F#6", false },
+  { "U-F#6", false },
+  { "D-A6", false },
+  { "A6", false },
+  { "U-A6", false },
+  { "D-C7", false },
+  { "C7", false },
+  { "U-C7", false },
+  { "D-D#7", false },
+  { "D#7", false },
+  { "U-D#7", false },
+  { "D-F#7", false },
+  { "F#7", false },
+  { "U-F#7", false },
+  { "D-A7", false },
+  { "A7", false },
+  { "U-A7", false },
+  { "D-C8", false },
+  { "C8", false },
+} };
+
+NoteRepository::NoteRepository( const string& sample_directory, const bool use_sample_bank )
+{
+  GlobalScopeTimer<Timer::Category::InitSynth> timer;
+
+  const string bank_filename = sample_directory + SAMPLE_BANK_FILENAME;
 
-  cerr << "Resizing all keydowns to " << maximum_keydown_length << " samples.\n";
+  if ( use_sample_bank and filesystem::exists( bank_filename ) ) {
+    map_sample_bank( bank_filename );
+  } else {
+    decode_notes( sample_directory );
+  }
 
-  for ( auto& x : notes ) {
-    x.getSlow().resize( maximum_keydown_length );
-    x.getMed().resize( maximum_keydown_length );
-    x.getFast().resize( maximum_keydown_length );
+  /* work out the crossfade for every velocity once, rather than on every key press */
+  for ( size_t velocity = 0; velocity < keydown_crossfades.size(); velocity++ ) {
+    keydown_crossfades[velocity] = crossfade_for_velocity( velocity );
   }
 }
 
-const std::vector<wav_frame_t> NoteRepository::get_wav( const bool direction,
-                                                        const size_t note,
-                                                        const uint8_t velocity ) const
+void NoteRepository::decode_notes( const string& sample_directory )
 {
-  if ( direction ) {
-    if ( velocity <= LOW_XFOUT_LOVEL ) {
-      return notes.at( note ).getSlow().samples();
-    } else if ( velocity <= LOW_XFOUT_HIVEL ) {
-      const WavWrapper& wav = notes.at( note ).getSlow();
-      const WavWrapper& wav_med = notes.at( note ).getMed();
-      std::vector<wav_frame_t> samples { wav_med.size() };
-      size_t i;
-      for ( i = 0; i < wav.size(); i++ ) {
-        std::pair<float, float> new_samp = wav.view( i );
-        new_samp.first *= ( LOW_XFOUT_HIVEL - velocity ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL );
-        new_samp.second *= ( LOW_XFOUT_HIVEL - velocity ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL );
-
-        std::pair<float, float> med_samp = wav_med.view( i );
-        new_samp.first
-          += med_samp.first * ( ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL ) );
-        new_samp.second
-          += med_samp.second * ( ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL ) );
-        samples[i] = { new_samp.first, new_samp.second };
-      }
+  /* decode on every core; each note has its own slot, so the order does not depend on timing */
+  vector<optional<NoteFiles>> decoded( NOTE_NAMES.size() );
+  atomic<size_t> next_note { 0 }, frames_before { 0 }, frames_after { 0 };
+  exception_ptr failure {};
+  mutex failure_mutex {};
 
-      while ( i < wav_med.size() ) {
-        std::pair<float, float> new_samp = wav_med.view( i );
-        new_samp.first
-          = new_samp.first * ( ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL ) );
-        new_samp.second
-          = new_samp.second * ( ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL ) );
-        samples[i] = { new_samp.first, new_samp.second };
-        i++;
-      }
+  auto decode_worker = [&] {
+    for ( size_t note = next_note++; note < decoded.size(); note = next_note++ ) {
+      try {
+        NoteFiles& files = decoded[note].emplace(
+          sample_directory, NOTE_NAMES[note].name, note + 1, NOTE_NAMES[note].has_damper );
 
-      return samples;
-    } else if ( velocity <= HIGH_XFIN_LOVEL ) {
-      const WavWrapper& wav = notes.at( note ).getMed();
-      std::vector<wav_frame_t> samples { wav.size() };
-      for ( size_t i = 0; i < wav.size(); i++ ) {
-        std::pair<float, float> new_samp = wav.view( i );
-        samples[i] = { new_samp.first, new_samp.second };
-      }
-      return samples;
-    } else if ( velocity <= HIGH_XFIN_HIVEL ) {
-      const WavWrapper& wav = notes.at( note ).getMed();
-      const WavWrapper& wav_fast = notes.at( note ).getFast();
-      std::vector<wav_frame_t> samples { wav_fast.size() };
-      size_t i;
-      for ( i = 0; i < wav.size(); i++ ) {
-        std::pair<float, float> new_samp = wav.view( i );
-        new_samp.first *= ( LOW_XFOUT_HIVEL - velocity ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL );
-        new_samp.second *= ( LOW_XFOUT_HIVEL - velocity ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL );
-
-        std::pair<float, float> fast_samp = wav_fast.view( i );
-        new_samp.first
-          += fast_samp.first * ( ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL ) );
-        new_samp.second
-          += fast_samp.second * ( ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL ) );
-        samples[i] = { new_samp.first, new_samp.second };
+        /* the recordings end in a long stretch of near-silence that is not worth mixing */
+        for ( WavWrapper* layer : { &files.getSlow(), &files.getMed(), &files.getFast(), &files.getRel() } ) {
+          frames_before += layer->size();
+          layer->trim_silence( SILENCE_THRESHOLD );
+          frames_after += layer->size();
+        }
+      } catch ( ... ) {
+        lock_guard<mutex> lock { failure_mutex };
+        if ( not failure ) {
+          failure = current_exception();
+        }
       }
+    }
+  };
+
+  vector<thread> workers;
+  const size_t worker_count = clamp<size_t>( thread::hardware_concurrency(), 1, decoded.size() );
+  for ( size_t i = 0; i < worker_count; i++ ) {
+    workers.emplace_back( decode_worker );
+  }
 
-      while ( i < wav_fast.size() ) {
-        std::pair<float, float> new_samp = wav_fast.view( i );
-        new_samp.first
-          = new_samp.first * ( ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL ) );
-        new_samp.second
-          = new_samp.second * ( ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL ) );
-        samples[i] = { new_samp.first, new_samp.second };
-        i++;
+  for ( auto& worker : workers ) {
+    worker.join();
+  }
+
+  if ( failure ) {
+    rethrow_exception( failure );
+  }
+
+  for ( auto& files : decoded ) {
+    notes.push_back( move( files.value() ) );
+  }
+
+  cerr << "Added " << notes.size() << " notes using " << worker_count << " threads\n";
+  cerr << "Trimmed silent tails from " << frames_before << " to " << frames_after << " frames.\n";
+
+  for ( const auto& x : notes ) {
+    NoteSamples& samples = note_samples.emplace_back();
+    samples[static_cast<size_t>( Layer::Slow )] = { x.getSlow().samples().data(), x.getSlow().size() };
+    samples[static_cast<size_t>( Layer::Med )] = { x.getMed().samples().data(), x.getMed().size() };
+    samples[static_cast<size_t>( Layer::Fast )] = { x.getFast().samples().data(), x.getFast().size() };
+    samples[static_cast<size_t>( Layer::Release )] = { x.getRel().samples().data(), x.getRel().size() };
+  }
+}
+
+void NoteRepository::map_sample_bank( const string& filename )
+{
+  bank.emplace( filename );
+  Parser parser { *bank };
+
+  string magic( BANK_MAGIC.size(), 0 );
+  parser.string( string_span::from_view( magic ) );
+  if ( magic != BANK_MAGIC ) {
+    throw runtime_error( filename + ": not a sample bank" );
+  }
+
+  uint32_t version, note_count;
+  parser.integer( version );
+  if ( version != BANK_VERSION ) {
+    throw runtime_error( filename + ": sample bank version " + to_string( version ) + ", expected "
+                         + to_string( BANK_VERSION ) + " (recompile it)" );
+  }
+  parser.integer( note_count );
+
+  for ( uint32_t note = 0; note < note_count; note++ ) {
+    NoteSamples& samples = note_samples.emplace_back();
+
+    for ( size_t layer = 0; layer < NUM_LAYERS; layer++ ) {
+      uint64_t offset, frames;
+      parser.integer( offset );
+      parser.integer( frames );
+
+      if ( offset % BANK_ALIGNMENT or offset > bank->length()
+           or frames > ( bank->length() - offset ) / sizeof( wav_frame_t ) ) {
+        throw runtime_error( filename + ": invalid sample offset for note " + to_string( note ) );
       }
 
-      return samples;
-    } else {
-      const WavWrapper& wav = notes.at( note ).getFast();
-      std::vector<wav_frame_t> samples { wav.size() };
-      for ( size_t i = 0; i < wav.size(); i++ ) {
-        std::pair<float, float> new_samp = wav.view( i );
-        samples[i] = { new_samp.first, new_samp.second };
+      samples[layer] = { reinterpret_cast<const wav_frame_t*>( bank->addr() + offset ), frames };
+    }
+  }
+
+  cerr << "Mapped " << note_samples.size() << " notes from " << filename << "\n";
+}
+
+void NoteRepository::write_sample_bank( const string& filename ) const
+{
+  const size_t header_length
+    = BANK_MAGIC.size() + 2 * sizeof( uint32_t ) + note_samples.size() * NUM_LAYERS * 2 * sizeof( uint64_t );
+
+  /* lay out the samples after the header */
+  vector<array<uint64_t, NUM_LAYERS>> offsets( note_samples.size() );
+  size_t bank_length = header_length;
+  for ( size_t note = 0; note < note_samples.size(); note++ ) {
+    for ( size_t layer = 0; layer < NUM_LAYERS; layer++ ) {
+      bank_length = ( bank_length + BANK_ALIGNMENT - 1 ) / BANK_ALIGNMENT * BANK_ALIGNMENT;
+      offsets[note][layer] = bank_length;
+      bank_length += note_samples[note][layer].byte_size();
+    }
+  }
+
+  string header( header_length, 0 );
+  Serializer serializer { string_span::from_view( header ) };
+  serializer.string( BANK_MAGIC );
+  serializer.integer( BANK_VERSION );
+  serializer.integer( static_cast<uint32_t>( note_samples.size() ) );
+  for ( size_t note = 0; note < note_samples.size(); note++ ) {
+    for ( size_t layer = 0; layer < NUM_LAYERS; layer++ ) {
+      serializer.integer( offsets[note][layer] );
+      serializer.integer( static_cast<uint64_t>( note_samples[note][layer].size() ) );
+    }
+  }
+
+  /* write beside the destination and rename, so a bank that is mapped elsewhere is never truncated */
+  const string temp_filename = filename + ".tmp";
+  {
+    ofstream output { temp_filename, ios::binary | ios::trunc };
+    if ( not output.is_open() ) {
+      throw runtime_error( "unable to open " + temp_filename + " for writing" );
+    }
+
+    output.write( header.data(), header.size() );
+    size_t written = header.size();
+
+    for ( size_t note = 0; note < note_samples.size(); note++ ) {
+      for ( size_t layer = 0; layer < NUM_LAYERS; layer++ ) {
+        const string padding( offsets[note][layer] - written, 0 );
+        const size_t sample_bytes = note_samples[note][layer].byte_size();
+        output.write( padding.data(), padding.size() );
+        output.write( reinterpret_cast<const char*>( note_samples[note][layer].data() ), sample_bytes );
+        written = offsets[note][layer] + sample_bytes;
       }
-      return samples;
     }
+
+    if ( not output.good() ) {
+      throw runtime_error( "error writing " + temp_filename );
+    }
+  }
+
+  CheckSystemCall( "rename( \"" + temp_filename + "\" )", rename( temp_filename.c_str(), filename.c_str() ) );
+}
+
+const std::vector<wav_frame_t> NoteRepository::get_wav( const bool direction,
+                                                        const size_t note,
+                                                        const uint8_t velocity ) const
+{
+  const WavCombination combo
+    = direction ? get_keydown_combination( note, velocity ) : get_release_combination( note );
+
+  std::vector<wav_frame_t> samples( max( combo.a.size(), combo.b.size() ) );
+
+  for ( size_t i = 0; i < combo.a.size(); i++ ) {
+    samples[i].first += combo.a[i].first * combo.a_weight;
+    samples[i].second += combo.a[i].second * combo.a_weight;
   }
 
-  const WavWrapper& wav = notes.at( note ).getRel();
-  std::vector<wav_frame_t> samples { wav.size() };
-  for ( size_t i = 0; i < wav.size(); i++ ) {
-    std::pair<float, float> new_samp = wav.view( i );
-    samples[i] = { new_samp.first, new_samp.second };
+  for ( size_t i = 0; i < combo.b.size(); i++ ) {
+    samples[i].first += combo.b[i].first * combo.b_weight;
+    samples[i].second += combo.b[i].second * combo.b_weight;
   }
+
   return samples;
 }
 
@@ -219,59 +331,73 @@ bool NoteRepository::note_finished( const bool direction,
                                     const uint8_t velocity,
                                     const unsigned long offset ) const
 {
+  auto at_end = [&]( const Layer which ) { return offset >= samples( note, which ).size(); };
+
   if ( direction ) {
     if ( velocity <= LOW_XFOUT_LOVEL ) {
-      return notes.at( note ).getSlow().at_end( offset );
+      return at_end( Layer::Slow );
     } else if ( velocity <= LOW_XFOUT_HIVEL ) {
-      return notes.at( note ).getMed().at_end( offset );
+      return at_end( Layer::Med );
     } else if ( velocity <= HIGH_XFIN_LOVEL ) {
-      return notes.at( note ).getMed().at_end( offset );
+      return at_end( Layer::Med );
     } else if ( velocity <= HIGH_XFIN_HIVEL ) {
-      return notes.at( note ).getFast().at_end( offset );
+      return at_end( Layer::Fast );
     } else {
-      return notes.at( note ).getFast().at_end( offset );
+      return at_end( Layer::Fast );
     }
   }
 
-  return notes.at( note ).getRel().at_end( offset );
-}
-
-void NoteRepository::add_notes( const string& sample_directory, const string& name, const bool has_damper )
-{
-  unsigned int release_sample_num = notes.size() + 1;
-  notes.emplace_back( sample_directory, name, release_sample_num, has_damper );
+  return at_end( Layer::Release );
 }
 
-NoteRepository::WavCombination NoteRepository::get_keydown_combination( const size_t note,
-                                                                        const uint8_t velocity ) const
+NoteRepository::Crossfade NoteRepository::crossfade_for_velocity( const uint8_t velocity )
 {
-  WavCombination ret;
+  Crossfade ret;
   if ( velocity <= LOW_XFOUT_LOVEL ) {
-    ret.a = &notes.at( note ).getSlow().samples();
-    ret.b = &notes.at( note ).getSlow().samples();
+    ret.a = ret.b = Layer::Slow;
     ret.a_weight = 1;
-    return ret;
   } else if ( velocity <= LOW_XFOUT_HIVEL ) {
-    ret.a = &notes.at( note ).getSlow().samples();
-    ret.b = &notes.at( note ).getMed().samples();
+    ret.a = Layer::Slow;
+    ret.b = Layer::Med;
     ret.a_weight = ( LOW_XFOUT_HIVEL - velocity ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL );
     ret.b_weight = ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL );
-    return ret;
   } else if ( velocity <= HIGH_XFIN_LOVEL ) {
-    ret.a = &notes.at( note ).getMed().samples();
-    ret.b = &notes.at( note ).getMed().samples();
+    ret.a = ret.b = Layer::Med;
     ret.a_weight = 1;
-    return ret;
   } else if ( velocity <= HIGH_XFIN_HIVEL ) {
-    ret.a = &notes.at( note ).getMed().samples();
-    ret.b = &notes.at( note ).getFast().samples();
-    ret.a_weight = ( LOW_XFOUT_HIVEL - velocity ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL );
-    ret.b_weight = ( velocity - LOW_XFOUT_LOVEL ) / ( LOW_XFOUT_HIVEL - LOW_XFOUT_LOVEL );
-    return ret;
+    ret.a = Layer::Med;
+    ret.b = Layer::Fast;
+    ret.a_weight = ( HIGH_XFIN_HIVEL - velocity ) / ( HIGH_XFIN_HIVEL - HIGH_XFIN_LOVEL );
+    ret.b_weight = ( velocity - HIGH_XFIN_LOVEL ) / ( HIGH_XFIN_HIVEL - HIGH_XFIN_LOVEL );
   } else {
-    ret.a = &notes.at( note ).getFast().samples();
-    ret.b = &notes.at( note ).getFast().samples();
+    ret.a = ret.b = Layer::Fast;
     ret.a_weight = 1;
-    return ret;
   }
+  return ret;
+}
+
+span_view<wav_frame_t> NoteRepository::samples( const size_t note, const Layer which ) const
+{
+  return note_samples.at( note )[static_cast<size_t>( which )];
+}
+
+NoteRepository::WavCombination NoteRepository::get_keydown_combination( const size_t note,
+                                                                        const uint8_t velocity ) const
+{
+  const Crossfade& crossfade = keydown_crossfades[velocity];
+
+  WavCombination ret;
+  ret.a = samples( note, crossfade.a );
+  ret.b = samples( note, crossfade.b );
+  ret.a_weight = crossfade.a_weight;
+  ret.b_weight = crossfade.b_weight;
+  return ret;
+}
+
+NoteRepository::WavCombination NoteRepository::get_release_combination( const size_t note ) const
+{
+  WavCombination ret;
+  ret.a = ret.b = samples( note, Layer::Release );
+  ret.a_weight = 1;
+  return ret;
 }
@@ -1,28 +1,74 @@
 #pragma once
 
+#include "mmap.hh"
 #include "note_files.hh"
+#include "spans.hh"
+#include <array>
+#include <limits>
+#include <optional>
 #include <vector>
 
 class NoteRepository
 {
-  std::vector<NoteFiles> notes {};
+  enum class Layer
+  {
+    Slow,
+    Med,
+    Fast,
+    Release
+  };
+
+  static constexpr size_t NUM_LAYERS = 4;
+
+  // Which keydown layers a velocity crossfades between, and with what weights
+  struct Crossfade
+  {
+    Layer a {}, b {};
+    float a_weight {}, b_weight {};
+  };
+
+  using NoteSamples = std::array<span_view<wav_frame_t>, NUM_LAYERS>;
 
-  void add_notes( const std::string& sample_directory, const std::string& name, const bool has_damper = true );
+  std::vector<NoteFiles> notes {};          // samples decoded from the WAV files...
+  std::optional<ReadOnlyFile> bank {};      // ... or mapped from a compiled sample bank
+  std::vector<NoteSamples> note_samples {}; // every note's layers, pointing into one of the above
+
+  std::array<Crossfade, std::numeric_limits<uint8_t>::max() + 1> keydown_crossfades {};
+
+  void decode_notes( const std::string& sample_directory );
+  void map_sample_bank( const std::string& filename );
+
+  static Crossfade crossfade_for_velocity( const uint8_t velocity );
+  span_view<wav_frame_t> samples( const size_t note, const Layer which ) const;
 
 public:
+  // Written by write_sample_bank(); if present in the sample directory, it is used instead of the WAV files
+  static constexpr const char* SAMPLE_BANK_FILENAME = "samples.bank";
+
+  // A view of a note's samples: a[i] * a_weight + b[i] * b_weight. Nothing is copied.
+  // The layers may differ in length; the shorter one is silent past its end.
   struct WavCombination
   {
-    const std::vector<wav_frame_t>* a {};
-    const std::vector<wav_frame_t>* b {};
+    span_view<wav_frame_t> a {};
+    span_view<wav_frame_t> b {};
     float a_weight {}, b_weight {};
   };
 
-  NoteRepository( const std::string& sample_directory );
+  // Construction time is recorded in global_timer() under InitSynth
+  NoteRepository( const std::string& sample_directory, const bool use_sample_bank = true );
 
+  // Save every layer, aligned for direct use once mapped
+  void write_sample_bank( const std::string& filename ) const;
+
+  bool from_sample_bank() const { return bank.has_value(); }
+
+  // Copies the combined samples into a new vector (use the combinations below on the MIDI path)
   const std::vector<wav_frame_t> get_wav( const bool direction, const size_t note, const uint8_t velocity ) const;
 
   WavCombination get_keydown_combination( const size_t note, const uint8_t velocity ) const;
 
+  WavCombination get_release_combination( const size_t note ) const;
+
   bool note_finished( const bool direction,
                       const size_t note,
                       const uint8_t velocity,
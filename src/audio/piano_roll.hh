@@ -1,5 +1,11 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 struct PianoRollEvent
@@ -14,3 +20,110 @@ using PianoRollColumn = std::array<float, N>;
 
 template<std::size_t N>
 using PianoRoll = std::vector<PianoRollColumn<N>>;
+
+// A piano-roll column with one bit per MIDI key: set for NoteDown, clear for NoteUp or Unknown
+// (which have the same value as network inputs). 16 bytes, instead of 512 as a PianoRollColumn.
+class PackedPianoRollColumn
+{
+  std::array<uint64_t, 2> words_ {};
+
+public:
+  static constexpr std::size_t size() { return 128; }
+
+  bool operator[]( const std::size_t key ) const { return ( words_[key / 64] >> ( key % 64 ) ) & 1; }
+
+  void set( const std::size_t key, const bool down )
+  {
+    const uint64_t bit = uint64_t( 1 ) << ( key % 64 );
+    words_[key / 64] = down ? words_[key / 64] | bit : words_[key / 64] & ~bit;
+  }
+
+  // Number of keys that are down
+  std::size_t count() const { return std::popcount( words_[0] ) + std::popcount( words_[1] ); }
+
+  bool operator==( const PackedPianoRollColumn& other ) const = default;
+
+  // Write keys first_key, first_key + 1, ... into `out` as NoteDown or NoteUp. `out` is any
+  // Eigen vector expression: a row of a network input, or a strided view of one (e.g.
+  // row( Eigen::seqN( column, 88, history ) ) for a key-major history). Only the keys that are
+  // down are visited after the fill.
+  template<class Vector>
+  void unpack( const std::size_t first_key, Vector&& out ) const
+  {
+    const std::size_t end_key = first_key + out.size();
+    if ( end_key > size() ) {
+      throw std::out_of_range( "PackedPianoRollColumn::unpack: keys past the end of the column" );
+    }
+
+    out.setConstant( PianoRollEvent::NoteUp );
+    for ( std::size_t word = 0; word < words_.size(); word++ ) {
+      for ( uint64_t bits = words_[word]; bits; bits &= bits - 1 ) {
+        const std::size_t key = word * 64 + std::countr_zero( bits );
+        if ( key >= first_key and key < end_key ) {
+          out( key - first_key ) = PianoRollEvent::NoteDown;
+        }
+      }
+    }
+  }
+};
+
+// A piano roll of packed columns, run-length encoded: a stretch of identical columns (a long
+// sustained chord, or a rest) is stored once, with the index just past its last column. Random
+// access is a binary search over the runs.
+class PackedPianoRoll
+{
+  std::vector<PackedPianoRollColumn> runs_ {};
+  std::vector<uint32_t> run_ends_ {};
+
+public:
+  std::size_t size() const { return run_ends_.empty() ? 0 : run_ends_.back(); }
+  bool empty() const { return run_ends_.empty(); }
+  std::size_t num_runs() const { return runs_.size(); }
+
+  // Append `count` copies of a column
+  void push_back( const PackedPianoRollColumn& column, const std::size_t count = 1 )
+  {
+    const std::size_t end = size() + count;
+    if ( end > std::numeric_limits<uint32_t>::max() ) {
+      throw std::length_error( "PackedPianoRoll: too many columns" );
+    }
+
+    if ( count == 0 ) {
+      return;
+    }
+
+    if ( not runs_.empty() and runs_.back() == column ) {
+      run_ends_.back() = uint32_t( end );
+    } else {
+      runs_.push_back( column );
+      run_ends_.push_back( uint32_t( end ) );
+    }
+  }
+
+  const PackedPianoRollColumn& operator[]( const std::size_t i ) const
+  {
+    return runs_[std::upper_bound( run_ends_.begin(), run_ends_.end(), i ) - run_ends_.begin()];
+  }
+
+  const PackedPianoRollColumn& at( const std::size_t i ) const
+  {
+    if ( i >= size() ) {
+      throw std::out_of_range( "PackedPianoRoll::at: " + std::to_string( i ) + " >= " + std::to_string( size() ) );
+    }
+    return ( *this )[i];
+  }
+
+  const PackedPianoRollColumn& back() const { return runs_.back(); }
+
+  // Bytes of heap memory held
+  std::size_t memory_usage() const
+  {
+    return runs_.capacity() * sizeof( PackedPianoRollColumn ) + run_ends_.capacity() * sizeof( uint32_t );
+  }
+
+  void shrink_to_fit()
+  {
+    runs_.shrink_to_fit();
+    run_ends_.shrink_to_fit();
+  }
+};
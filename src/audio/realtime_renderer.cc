@@ -0,0 +1,128 @@
+#include "realtime_renderer.hh"
+#include "exception.hh"
+#include "timestamp.hh"
+
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+/* how long the render thread sleeps without audio output before checking for shutdown */
+constexpr int POLL_TIMEOUT_MS = 10;
+
+constexpr int REALTIME_PRIORITY = 70;
+
+RealtimeRenderer::RealtimeRenderer( unique_ptr<AudioInterface>&& playback, const string& sample_directory )
+  : playback_( move( playback ) )
+  , synth_( sample_directory )
+  , render_thread_( [this] { render_loop(); } )
+{}
+
+RealtimeRenderer::~RealtimeRenderer()
+{
+  stop_requested_ = true;
+  render_thread_.join();
+}
+
+bool RealtimeRenderer::push_midi_event( const MidiEvent& event )
+{
+  span<MidiEvent> space = midi_events_.writable_region();
+  if ( space.size() == 0 ) {
+    dropped_events_++;
+    return false;
+  }
+
+  space[0] = event;
+  midi_events_.push( 1 );
+  return true;
+}
+
+void RealtimeRenderer::render_loop()
+{
+  sched_param param {};
+  param.sched_priority = min( REALTIME_PRIORITY, sched_get_priority_max( SCHED_FIFO ) );
+  const int ret = pthread_setschedparam( pthread_self(), SCHED_FIFO, &param );
+  if ( ret ) {
+    cerr << "RealtimeRenderer: could not set SCHED_FIFO priority (" << strerror( ret )
+         << "), rendering at normal priority\n";
+  }
+  realtime_priority_ = ( ret == 0 );
+
+  try {
+    while ( not stop_requested_ ) {
+      render_and_play();
+      publish_statistics();
+    }
+  } catch ( const exception& e ) {
+    cerr << "RealtimeRenderer: " << e.what() << "\n";
+    running_ = false;
+  }
+}
+
+void RealtimeRenderer::render_and_play()
+{
+  /* apply every MIDI event that has arrived */
+  const span_view<MidiEvent> events = midi_events_.readable_region();
+  for ( const MidiEvent& event : events ) {
+    synth_.process_new_data( event.type, event.note, event.velocity );
+  }
+  midi_events_.pop( events.size() );
+
+  /* commit to an output signal until RENDER_AHEAD frames in the future */
+  if ( synth_.frames_rendered() <= playback_->cursor() + RENDER_AHEAD ) {
+    const size_t frames_to_render = playback_->cursor() + RENDER_AHEAD + 1 - synth_.frames_rendered();
+    synth_.render( audio_signal_.writable_region().substr( 0, frames_to_render ) );
+    audio_signal_.push( frames_to_render );
+  }
+
+  /* sleep until there is room in the output buffer */
+  pollfd output { playback_->fd().fd_num(), POLLOUT, 0 };
+  CheckSystemCall( "poll", ::poll( &output, 1, POLL_TIMEOUT_MS ) );
+
+  if ( output.revents & POLLERR ) {
+    /* buffer overrun/underrun: recover the ALSA interface */
+    playback_->recover();
+  } else if ( output.revents & POLLOUT ) {
+    audio_signal_.pop( playback_->play( audio_signal_.readable_region() ) );
+  }
+}
+
+void RealtimeRenderer::publish_statistics()
+{
+  const AudioStatistics& stats = playback_->statistics();
+  cursor_.store( playback_->cursor(), memory_order_relaxed );
+  wakeups_.store( stats.wakeups, memory_order_relaxed );
+  xruns_.store( stats.xruns, memory_order_relaxed );
+  recoveries_.store( stats.recoveries, memory_order_relaxed );
+}
+
+void RealtimeRenderer::summary( ostream& out ) const
+{
+  out << "Realtime renderer (" << ( realtime_priority_ ? "SCHED_FIFO" : "normal priority" ) << "): ";
+
+  out << " cursor=";
+  pp_samples( out, cursor_ );
+
+  out << " wakeups=" << wakeups_;
+
+  if ( recoveries_ ) {
+    out << " total recoveries=" << recoveries_;
+  }
+
+  if ( xruns_ ) {
+    out << " xruns=" << xruns_;
+  }
+
+  if ( dropped_events_ ) {
+    out << " dropped MIDI events=" << dropped_events_;
+  }
+
+  if ( not running_ ) {
+    out << " (stopped)";
+  }
+
+  out << "\n";
+}
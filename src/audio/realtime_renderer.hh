@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "alsa_devices.hh"
+#include "summarize.hh"
+#include "synthesizer.hh"
+#include "typed_ring_buffer.hh"
+
+// Runs the synthesizer and audio output on their own (SCHED_FIFO, if permitted) thread,
+// so nothing else the program does can delay audio. MIDI events are handed over
+// through a lock-free queue; the renderer owns the AudioInterface and the Synthesizer.
+class RealtimeRenderer : public Summarizable
+{
+public:
+  struct MidiEvent
+  {
+    uint8_t type, note, velocity;
+  };
+
+private:
+  // render no more than this many frames ahead of the playback cursor (1.3 ms)
+  static constexpr size_t RENDER_AHEAD = 64;
+
+  std::unique_ptr<AudioInterface> playback_;
+  Synthesizer synth_;
+
+  SPSCRingBuffer<MidiEvent> midi_events_ { 4096 };
+  TypedRingBuffer<wav_frame_t> audio_signal_ { 16384 }; // the output signal, from cursor() onwards
+
+  /* written by the render thread, read by summary() */
+  std::atomic<size_t> cursor_ { 0 };
+  std::atomic<unsigned int> wakeups_ { 0 }, xruns_ { 0 }, recoveries_ { 0 };
+  std::atomic<bool> realtime_priority_ { false }, running_ { true };
+
+  std::atomic<unsigned int> dropped_events_ { 0 };
+  std::atomic<bool> stop_requested_ { false };
+
+  std::thread render_thread_;
+
+  void render_loop();
+  void render_and_play();
+  void publish_statistics();
+
+public:
+  RealtimeRenderer( std::unique_ptr<AudioInterface>&& playback, const std::string& sample_directory );
+  ~RealtimeRenderer();
+
+  // Called from one (non-render) thread; returns false, and drops the event, if the queue is full
+  bool push_midi_event( const MidiEvent& event );
+
+  // False once the render thread has stopped on an error
+  bool running() const { return running_; }
+
+  void summary( std::ostream& out ) const override;
+
+  /* can't copy or assign */
+  RealtimeRenderer( const RealtimeRenderer& other ) = delete;
+  RealtimeRenderer& operator=( const RealtimeRenderer& other ) = delete;
+};
@@ -1,4 +1,7 @@
 #include "synthesizer.hh"
+#include "mix_kernels.hh"
+
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -9,12 +12,20 @@ constexpr unsigned int KEY_DOWN = 144;
 constexpr unsigned int KEY_UP = 128;
 constexpr unsigned int SUSTAIN = 176;
 
+constexpr float KEYDOWN_GAIN = 0.2; /* to avoid clipping */
+const float RELEASE_GAIN = exp10( -37 / 20.0 ) * 0.2;
+
+/* once the damper closes, a voice fades to silence over this many frames */
+constexpr size_t DAMPER_FRAMES = 10000;
+constexpr float DAMPER_STEP = 1.0 / DAMPER_FRAMES;
+
 using namespace std;
 
 Synthesizer::Synthesizer( const string& sample_directory )
   : note_repo( sample_directory )
-  , keys( NUM_KEYS )
-{}
+{
+  voices.reserve( MAX_VOICES );
+}
 
 void Synthesizer::process_new_data( uint8_t event_type, uint8_t event_note, uint8_t event_velocity )
 {
@@ -34,122 +45,179 @@ void Synthesizer::process_new_data( uint8_t event_type, uint8_t event_note, uint
   }
 }
 
-void Synthesizer::add_key_press( uint8_t adj_event_note, uint8_t event_vel )
+void Synthesizer::add_voice( const Voice& voice )
 {
-  auto& k = keys.at( adj_event_note );
-  k.released = false;
-
-  const std::vector<std::pair<float, float>> samples = note_repo.get_wav( true, adj_event_note, event_vel );
-  auto key_region = k.future.mutable_storage( frames_processed % FUTURE_LENGTH );
-  auto total_region = total_future.mutable_storage( frames_processed % FUTURE_LENGTH );
-
-  size_t offset = 0;
-
-  // Update key future and total future
-  while ( !note_repo.note_finished( true, adj_event_note, event_vel, offset ) ) {
-    float amplitude_multiplier = 0.2; /* to avoid clipping */
+  if ( voice.key >= NUM_KEYS ) {
+    throw runtime_error( "key out of range: " + to_string( voice.key ) );
+  }
 
-    const std::pair<float, float> curr_sample = samples.at( offset );
+  drop_finished_voices();
 
-    // Update key future
-    auto& sample = key_region[offset];
-    sample.first += curr_sample.first * amplitude_multiplier;
-    sample.second += curr_sample.second * amplitude_multiplier;
+  if ( voices.size() < MAX_VOICES ) {
+    voices.push_back( voice );
+  } else {
+    /* steal the oldest voice */
+    *min_element( voices.begin(), voices.end(), []( const Voice& x, const Voice& y ) {
+      return x.start_frame < y.start_frame;
+    } ) = voice;
+  }
 
-    // Update total future
-    auto& total_sample = total_region[offset];
-    total_sample.first += curr_sample.first * amplitude_multiplier;
-    total_sample.second += curr_sample.second * amplitude_multiplier;
+  /* the rest of the current block has to include the new voice */
+  block_valid = false;
+}
 
-    offset++;
-  }
+void Synthesizer::add_key_press( uint8_t adj_event_note, uint8_t event_vel )
+{
+  Voice voice;
+  voice.combo = note_repo.get_keydown_combination( adj_event_note, event_vel );
+  voice.gain = KEYDOWN_GAIN;
+  voice.length = max( voice.combo.a.size(), voice.combo.b.size() );
+  voice.start_frame = frames_processed;
+  voice.key = adj_event_note;
+
+  add_voice( voice );
 }
 
 void Synthesizer::add_shallow_key_press( uint8_t adj_event_note, uint8_t event_vel )
 {
-  auto& k = keys.at( adj_event_note );
-  k.released = false;
-
-  NoteRepository::WavCombination combo = note_repo.get_keydown_combination( adj_event_note, event_vel );
-  auto key_region = k.future.mutable_storage( frames_processed % FUTURE_LENGTH );
-  auto total_region = total_future.mutable_storage( frames_processed % FUTURE_LENGTH );
+  Voice voice;
+  voice.combo = note_repo.get_keydown_combination( adj_event_note, event_vel );
+  voice.gain = 1.0;
+  voice.length = max( voice.combo.a.size(), voice.combo.b.size() );
+  voice.start_frame = frames_processed;
+  voice.key = adj_event_note;
+
+  add_voice( voice );
+}
 
-  const size_t max_size = combo.a->size();
-  if ( max_size > total_region.size() or max_size > key_region.size() or max_size > FUTURE_LENGTH ) {
-    throw runtime_error( "note too big!" );
+void Synthesizer::add_key_release( uint8_t adj_event_note, uint8_t event_vel )
+{
+  (void)event_vel;
+
+  /* close the damper on everything this key is sounding */
+  if ( !sustain_down ) {
+    for ( auto& voice : voices ) {
+      if ( voice.key == adj_event_note and voice.release_frame == NOT_RELEASED ) {
+        voice.release_frame = frames_processed;
+      }
+    }
   }
 
-  const vector<wav_frame_t>& a = *combo.a;
-  const vector<wav_frame_t>& b = *combo.b;
-
-  // Update key future and total future
-  for ( size_t i = 0; i < max_size; i++ ) {
-    const std::pair<float, float> curr_sample = { a[i].first * combo.a_weight + b[i].first * combo.b_weight,
-                                                  a[i].second * combo.a_weight + b[i].second * combo.b_weight };
+  /* add release sound */
+  Voice voice;
+  voice.combo = note_repo.get_release_combination( adj_event_note );
+  voice.gain = RELEASE_GAIN;
+  voice.length = voice.combo.a.size();
+  voice.start_frame = frames_processed;
+  voice.key = adj_event_note;
 
-    // Update key future
-    key_region[i].first += curr_sample.first;
-    key_region[i].second += curr_sample.second;
+  add_voice( voice );
+}
 
-    // Update total future
-    total_region[i].first += curr_sample.first;
-    total_region[i].second += curr_sample.second;
+size_t Synthesizer::Voice::end_frame() const
+{
+  const size_t sample_end = start_frame + length;
+  if ( release_frame == NOT_RELEASED ) {
+    return sample_end;
   }
+  return min( sample_end, release_frame + DAMPER_FRAMES );
 }
 
-void Synthesizer::add_key_release( uint8_t adj_event_note, uint8_t event_vel )
+void Synthesizer::Voice::mix( wav_frame_t* out, const size_t out_start, const size_t count ) const
 {
-  auto& k = keys.at( adj_event_note );
-  k.released = true;
-
-  float vol_ratio = 1.0;
+  const size_t begin = max( out_start, start_frame );
+  const size_t end = min( out_start + count, end_frame() );
 
-  const std::vector<std::pair<float, float>> rel_samples = note_repo.get_wav( true, adj_event_note, event_vel );
-  auto key_region = k.future.mutable_storage( frames_processed % FUTURE_LENGTH );
-  auto total_region = total_future.mutable_storage( frames_processed % FUTURE_LENGTH );
+  if ( begin >= end ) {
+    return;
+  }
 
-  // Update key future and total future
-  for ( size_t offset = 0; offset < 48000 * 30; offset++ ) {
-    auto& key_sample = key_region[offset];
-    auto& total_sample = total_region[offset];
+  /* split where the damper closes and where the shorter layer runs out */
+  const size_t undamped_end = clamp( release_frame, begin, end );
+  const size_t overlap_end = clamp( start_frame + min( combo.a.size(), combo.b.size() ), begin, end );
 
-    if ( vol_ratio > 0 )
-      vol_ratio -= 0.0001;
+  mix_segment( out, out_start, begin, min( undamped_end, overlap_end ) );
+  mix_segment( out, out_start, min( undamped_end, overlap_end ), max( undamped_end, overlap_end ) );
+  mix_segment( out, out_start, max( undamped_end, overlap_end ), end );
+}
 
-    if ( !sustain_down ) {
-      const std::pair<float, float> new_sample = { key_sample.first * vol_ratio, key_sample.second * vol_ratio };
+void Synthesizer::Voice::mix_segment( wav_frame_t* out,
+                                      const size_t out_start,
+                                      const size_t from,
+                                      const size_t to ) const
+{
+  if ( from >= to ) {
+    return;
+  }
 
-      // Update total future by getting delta of new key future and old key future
-      total_sample.first += new_sample.first - key_sample.first;
-      total_sample.second += new_sample.second - key_sample.second;
+  wav_frame_t* dest = out + ( from - out_start );
+  const size_t offset = from - start_frame;
+  const size_t frames = to - from;
+
+  const wav_frame_t* a = offset < combo.a.size() ? combo.a.data() + offset : nullptr;
+  const wav_frame_t* b = offset < combo.b.size() ? combo.b.data() + offset : nullptr;
+  float a_gain = combo.a_weight * gain;
+  float b_gain = combo.b_weight * gain;
+
+  /* past the end of the shorter layer, only the longer one sounds */
+  if ( not a ) {
+    a = b;
+    a_gain = 0;
+  } else if ( not b ) {
+    b = a;
+    b_gain = 0;
+  }
 
-      // Update key future
-      key_sample = new_sample;
+  if ( from < release_frame ) {
+    if ( a == b ) {
+      MixKernels::mix( dest, a, a_gain + b_gain, frames );
+    } else {
+      MixKernels::crossfade( dest, a, a_gain, b, b_gain, frames );
     }
+  } else {
+    /* after the damper closes: linear fade to silence */
+    const float first_ratio = 1.0f - DAMPER_STEP * ( from - release_frame + 1 );
+    MixKernels::crossfade_ramp( dest, a, a_gain, b, b_gain, first_ratio, -DAMPER_STEP, frames );
+  }
+}
 
-    // Add release sound
-    if ( !note_repo.note_finished( false, adj_event_note, event_vel, offset ) ) {
-      float amplitude_multiplier = exp10( -37 / 20.0 ) * 0.2;
-
-      const std::pair<float, float> rel_sample = rel_samples[offset];
+void Synthesizer::drop_finished_voices()
+{
+  erase_if( voices, [&]( const Voice& v ) { return v.end_frame() <= frames_processed; } );
+}
 
-      // Update key future
-      key_sample.first += rel_sample.first * amplitude_multiplier;
-      key_sample.second += rel_sample.second * amplitude_multiplier;
+void Synthesizer::mix_voices( wav_frame_t* out, const size_t out_start, const size_t count ) const
+{
+  fill( out, out + count, wav_frame_t {} );
 
-      // Update total future
-      total_sample.first += rel_sample.first * amplitude_multiplier;
-      total_sample.second += rel_sample.second * amplitude_multiplier;
-    }
+  for ( const auto& voice : voices ) {
+    voice.mix( out, out_start, count );
   }
 }
 
+void Synthesizer::render( span<wav_frame_t> out )
+{
+  drop_finished_voices();
+  mix_voices( out.mutable_data(), frames_processed, out.size() );
+  frames_processed += out.size();
+}
+
 wav_frame_t Synthesizer::get_curr_sample() const
 {
-  return total_future.storage( frames_processed )[0];
+  if ( not block_valid or frames_processed >= block_start + BLOCK_SIZE ) {
+    mix_voices( block.data(), frames_processed, BLOCK_SIZE );
+    block_start = frames_processed;
+    block_valid = true;
+  }
+
+  return block[frames_processed - block_start];
 }
 
 void Synthesizer::advance_sample()
 {
   frames_processed++;
+
+  if ( frames_processed >= block_start + BLOCK_SIZE ) {
+    drop_finished_voices();
+  }
 }
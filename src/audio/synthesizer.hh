@@ -2,30 +2,52 @@
 
 #include "midi_processor.hh"
 #include "note_repository.hh"
-#include "typed_ring_buffer.hh"
+#include "spans.hh"
 
-#include <deque>
+#include <array>
+#include <limits>
 #include <vector>
 
-static constexpr unsigned int FUTURE_LENGTH
-  = 2425 * 4096; // just longer than longest piano sample (25.862625 seconds)
-
 class Synthesizer
 {
-  using ChannelPair = TypedRingStorage<std::pair<float, float>>;
+  // frames mixed at a time, and the most voices that can sound at once
+  static constexpr size_t BLOCK_SIZE = 64;
+  static constexpr size_t MAX_VOICES = 256;
+
+  static constexpr size_t NOT_RELEASED = std::numeric_limits<size_t>::max();
+
+  using Block = std::array<wav_frame_t, BLOCK_SIZE>;
 
-  struct key
+  // One sounding sample: a (possibly crossfaded) note layer, started at an absolute frame.
+  // Voices are only mixed when output is needed, so a key press costs nothing up front.
+  struct Voice
   {
-    ChannelPair future { FUTURE_LENGTH };
-    bool released = false;
+    NoteRepository::WavCombination combo {};
+    float gain {};
+    size_t length {};
+    size_t start_frame {};
+    size_t release_frame { NOT_RELEASED }; // where the damper starts to silence the voice
+    uint8_t key {};
+
+    size_t end_frame() const;
+    void mix( wav_frame_t* out, const size_t out_start, const size_t count ) const;
+    void mix_segment( wav_frame_t* out, const size_t out_start, const size_t from, const size_t to ) const;
   };
 
   NoteRepository note_repo;
-  std::vector<key> keys;
-  ChannelPair total_future { FUTURE_LENGTH };
+  std::vector<Voice> voices {};
   bool sustain_down = false;
   size_t frames_processed = 0;
 
+  // frames around the current one, for callers that go one sample at a time
+  mutable Block block {};
+  mutable size_t block_start = 0;
+  mutable bool block_valid = false;
+
+  void add_voice( const Voice& voice );
+  void drop_finished_voices();
+  void mix_voices( wav_frame_t* out, const size_t out_start, const size_t count ) const;
+
 public:
   Synthesizer( const std::string& sample_directory );
 
@@ -37,7 +59,14 @@ public:
 
   void add_shallow_key_press( uint8_t adj_event_note, uint8_t event_vel );
 
+  // Fill `out` with the next out.size() frames and advance past them
+  void render( span<wav_frame_t> out );
+
   wav_frame_t get_curr_sample() const;
 
   void advance_sample();
+
+  size_t frames_rendered() const { return frames_processed; }
+
+  size_t active_voices() const { return voices.size(); }
 };
@@ -93,3 +93,13 @@ void WavWrapper::bend_pitch( const double pitch_bend_ratio )
 
   to_stereo( new_samples, samples_ );
 }
+
+void WavWrapper::trim_silence( const float threshold )
+{
+  auto last_audible = find_if( samples_.rbegin(), samples_.rend(), [&]( const wav_frame_t& x ) {
+    return abs( x.first ) >= threshold or abs( x.second ) >= threshold;
+  } );
+
+  samples_.erase( last_audible.base(), samples_.end() );
+  samples_.shrink_to_fit();
+}
@@ -29,6 +29,9 @@ public:
 
   void bend_pitch( const double pitch_bend_ratio );
 
+  /* drop trailing frames where both channels are below `threshold` */
+  void trim_silence( const float threshold );
+
   /* can't copy or assign */
   WavWrapper( const WavWrapper& other ) = delete;
   WavWrapper& operator=( const WavWrapper& other ) = delete;
@@ -137,7 +137,7 @@ int main( int argc, char* argv[] )
     for ( const auto& entry : filesystem::directory_iterator( midi_directory ) ) {
       if ( entry.path().extension() == ".mid" ) {
         cout << "Using file: " << entry.path() << "\n";
-        midi_files.emplace_back( MidiFile( entry.path() ) );
+        midi_files.emplace_back( MidiFile( entry.path(), &cout ) );
         if ( midi_files.back().tracks().size() == 0 ) {
           cout << "No tracks found; skipping!"
                << "\n";
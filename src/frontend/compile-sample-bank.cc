@@ -0,0 +1,52 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "note_repository.hh"
+#include "timer.hh"
+
+using namespace std;
+
+void program_body( const string& sample_directory, const string& bank_filename )
+{
+  const NoteRepository repo { sample_directory, false };
+
+  {
+    GlobalScopeTimer<Timer::Category::Nonblock> timer;
+    repo.write_sample_bank( bank_filename );
+  }
+
+  cout << "Wrote " << bank_filename << "\n";
+
+  /* make sure it maps back */
+  const NoteRepository mapped { sample_directory };
+  if ( bank_filename == sample_directory + NoteRepository::SAMPLE_BANK_FILENAME and not mapped.from_sample_bank() ) {
+    throw runtime_error( "sample bank was not used" );
+  }
+
+  global_timer().summary( cout );
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 2 and argc != 3 ) {
+    cerr << "Usage: " << argv[0] << " sample_directory [bank_filename]\n";
+    return EXIT_FAILURE;
+  }
+
+  const string sample_directory = argv[1];
+
+  try {
+    program_body( sample_directory,
+                  argc == 3 ? argv[2] : sample_directory + NoteRepository::SAMPLE_BANK_FILENAME );
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
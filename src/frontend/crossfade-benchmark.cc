@@ -0,0 +1,100 @@
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "note_repository.hh"
+#include "timer.hh"
+
+using namespace std;
+
+static constexpr size_t BLOCK_SIZE = 64;
+static constexpr size_t NUM_KEYS = 88;
+static constexpr array<uint8_t, 6> VELOCITIES { 1, 30, 63, 80, 100, 127 };
+
+static void print_latency( const string_view name, const Timer::Record& record )
+{
+  cout << "   " << name << ": " << string( 32 - name.size(), ' ' );
+  cout << "[mean=";
+  Timer::pp_ns( cout, record.count ? record.total_ns / record.count : 0 );
+  cout << "] [worst=";
+  Timer::pp_ns( cout, record.max_ns );
+  cout << "] [count=" << record.count << "]\n";
+}
+
+/* what the synthesizer does with a combination when a key is pressed: mix the first block */
+static float mix_first_block( const NoteRepository::WavCombination& combo )
+{
+  array<wav_frame_t, BLOCK_SIZE> block {};
+  for ( size_t i = 0; i < block.size() and i < combo.a.size() and i < combo.b.size(); i++ ) {
+    block[i].first += combo.a[i].first * combo.a_weight + combo.b[i].first * combo.b_weight;
+    block[i].second += combo.a[i].second * combo.a_weight + combo.b[i].second * combo.b_weight;
+  }
+  return block.back().first;
+}
+
+void program_body( const string& sample_directory )
+{
+  NoteRepository repo { sample_directory };
+
+  Timer::Record copy_keydown {}, copy_release {}, view_keydown {}, view_release {};
+
+  /* keep the compiler from discarding the work */
+  float checksum = 0;
+
+  for ( size_t note = 0; note < NUM_KEYS; note++ ) {
+    for ( const auto velocity : VELOCITIES ) {
+      {
+        RecordScopeTimer<Timer::Category::GetWav> timer { copy_keydown };
+        checksum += repo.get_wav( true, note, velocity ).size();
+      }
+
+      {
+        RecordScopeTimer<Timer::Category::GetWav> timer { view_keydown };
+        checksum += mix_first_block( repo.get_keydown_combination( note, velocity ) );
+      }
+    }
+
+    {
+      RecordScopeTimer<Timer::Category::GetWav> timer { copy_release };
+      checksum += repo.get_wav( false, note, 0 ).size();
+    }
+
+    {
+      RecordScopeTimer<Timer::Category::GetWav> timer { view_release };
+      checksum += mix_first_block( repo.get_release_combination( note ) );
+    }
+  }
+
+  global_timer().summary( cout );
+
+  cout << "\nPer-note latency\n----------------\n\n";
+  print_latency( "Keydown, copied vector", copy_keydown );
+  print_latency( "Keydown, combination view", view_keydown );
+  print_latency( "Release, copied vector", copy_release );
+  print_latency( "Release, combination view", view_release );
+  cout << "\n   (checksum " << checksum << ")\n";
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 2 ) {
+    cerr << "Usage: " << argv[0] << " sample_directory\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body( argv[1] );
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
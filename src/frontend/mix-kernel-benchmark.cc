@@ -0,0 +1,86 @@
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mix_kernels.hh"
+#include "timer.hh"
+
+using namespace std;
+using MixKernels::StereoFrame;
+
+static constexpr size_t BLOCK_SIZE = 64;
+static constexpr size_t ITERATIONS = 200000;
+
+/* run `kernel` over one block repeatedly and report throughput */
+static void benchmark( const string_view name, const function<void()>& kernel )
+{
+  const uint64_t start = Timer::timestamp_ns();
+  for ( size_t i = 0; i < ITERATIONS; i++ ) {
+    kernel();
+  }
+  const uint64_t elapsed_ns = Timer::timestamp_ns() - start;
+
+  const double frames_per_second = BLOCK_SIZE * ITERATIONS / ( elapsed_ns / BILLION );
+  cout << "   " << name << ": " << string( 32 - name.size(), ' ' );
+  cout << frames_per_second / MILLION << " M frames/s\n";
+}
+
+void program_body()
+{
+  vector<StereoFrame> out( BLOCK_SIZE ), a( BLOCK_SIZE ), b( BLOCK_SIZE );
+  vector<float> left( BLOCK_SIZE ), right( BLOCK_SIZE );
+  vector<int32_t> samples( 2 * BLOCK_SIZE );
+  for ( size_t i = 0; i < BLOCK_SIZE; i++ ) {
+    a[i] = { 0.001f * i, -0.001f * i };
+    b[i] = { -0.002f * i, 0.002f * i };
+    left[i] = 0.01f * i;
+    right[i] = -0.01f * i;
+  }
+
+  cout << "Mixing kernels (" << MixKernels::instruction_set() << "), " << BLOCK_SIZE << "-frame blocks\n\n";
+
+  benchmark( "mix", [&] { MixKernels::mix( out.data(), a.data(), 0.5, BLOCK_SIZE ); } );
+  benchmark( "mix (scalar)", [&] { MixKernels::Scalar::mix( out.data(), a.data(), 0.5, BLOCK_SIZE ); } );
+
+  benchmark( "crossfade",
+             [&] { MixKernels::crossfade( out.data(), a.data(), 0.3, b.data(), 0.7, BLOCK_SIZE ); } );
+  benchmark( "crossfade (scalar)",
+             [&] { MixKernels::Scalar::crossfade( out.data(), a.data(), 0.3, b.data(), 0.7, BLOCK_SIZE ); } );
+
+  benchmark( "crossfade_ramp", [&] {
+    MixKernels::crossfade_ramp( out.data(), a.data(), 0.3, b.data(), 0.7, 1.0, -0.0001, BLOCK_SIZE );
+  } );
+  benchmark( "crossfade_ramp (scalar)", [&] {
+    MixKernels::Scalar::crossfade_ramp( out.data(), a.data(), 0.3, b.data(), 0.7, 1.0, -0.0001, BLOCK_SIZE );
+  } );
+
+  benchmark( "to_int32", [&] { MixKernels::to_int32( samples.data(), out.data(), BLOCK_SIZE ); } );
+  benchmark( "to_int32 (scalar)", [&] { MixKernels::Scalar::to_int32( samples.data(), out.data(), BLOCK_SIZE ); } );
+
+  benchmark( "planar_to_int32",
+             [&] { MixKernels::planar_to_int32( samples.data(), left.data(), right.data(), BLOCK_SIZE ); } );
+  benchmark( "planar_to_int32 (scalar)", [&] {
+    MixKernels::Scalar::planar_to_int32( samples.data(), left.data(), right.data(), BLOCK_SIZE );
+  } );
+
+  /* keep the compiler from discarding the work */
+  cout << "\n   (checksum " << out[BLOCK_SIZE - 1].first + samples[0] << ")\n";
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  program_body();
+
+  return EXIT_SUCCESS;
+}
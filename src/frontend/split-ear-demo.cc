@@ -64,10 +64,7 @@ void program_body( const string_view audio_device, const string& midi_device )
   };
   deque<Press> pending_queue {};
   deque<Press> history_queue {};
-  deque<array<bool, 88>> piano_roll { {} };
-  for ( size_t i = 0; i < 88; i++ ) {
-    piano_roll.back()[i] = PianoRollEvent::Unknown;
-  }
+  SimpleNN::Window piano_roll {};
 
   /* get ready to play an audio signal */
   ChannelPair audio_signal { 16384 };  // the output signal
@@ -208,10 +205,7 @@ void program_body( const string_view audio_device, const string& midi_device )
       const auto now = steady_clock::now();
 
       if ( now > next_tick_time ) {
-        piano_roll.push_back( piano_roll.back() );
-        if ( piano_roll.size() > SimpleNN::HISTORY + 1 ) {
-          piano_roll.pop_front();
-        }
+        piano_roll.advance();
         next_tick_time = next_tick_time + beat_length / 4;
       }
     },
@@ -225,15 +219,17 @@ void program_body( const string_view audio_device, const string& midi_device )
       const auto delayed_now = now - simulated_latency;
       std::vector<SimpleNN::KeyPress> past_timestamps;
 
+      SimpleNN::Column current = piano_roll.current();
       for ( const auto& press : history_queue ) {
         if ( press.key < 21 or press.key > 108 )
           continue;
         if ( press.time > delayed_now - beat_length / 4 ) {
-          piano_roll.back()[press.key - 21] = press.velocity > 0 ? true : false;
+          current[press.key - 21] = press.velocity > 0 ? true : false;
         }
       }
+      piano_roll.set_current( current );
 
-      if ( piano_roll.size() < 2 ) {
+      if ( piano_roll.timeslots() < 2 ) {
         for ( size_t i = 0; i < 88; i++ ) {
           should_play_next_pred[i] = false;
         }
@@ -241,18 +237,16 @@ void program_body( const string_view audio_device, const string& midi_device )
         return;
       }
 
-      vector<array<bool, 88>> old_notes( piano_roll.begin(), piano_roll.end() - 1 );
-      nn.train_next_note_values( old_notes, piano_roll.back() );
+      nn.train_next_note_values( piano_roll );
 
-      vector<array<bool, 88>> notes( piano_roll.begin() + 1, piano_roll.end() );
       cerr << "\n";
-      for ( size_t j = 0; j < notes.size(); j++ ) {
+      for ( size_t j = 0; j < SimpleNN::HISTORY; j++ ) {
         for ( size_t i = 0; i < 88; i++ ) {
-          cerr << (bool)notes[j][i];
+          cerr << (bool)piano_roll.column( j )[i];
         }
         cerr << "\n";
       }
-      const array<bool, 88> next_pred = nn.predict_next_note_values( notes );
+      const array<bool, 88> next_pred = nn.predict_next_note_values( piano_roll );
       for ( size_t i = 0; i < 88; i++ ) {
         should_play_next_pred[i] = next_pred[i] and not played_last_pred[i];
         if ( not next_pred[i] ) {
@@ -8,56 +8,84 @@
 
 using namespace std;
 
+static constexpr size_t BLOCK_SIZE = 64;
+static constexpr size_t CHORD_SIZE = 10;
+
+static void print_latency( const string_view name, const Timer::Record& record )
+{
+  cout << "   " << name << ": " << string( 24 - name.size(), ' ' );
+  cout << "[mean=";
+  Timer::pp_ns( cout, record.count ? record.total_ns / record.count : 0 );
+  cout << "] [worst=";
+  Timer::pp_ns( cout, record.max_ns );
+  cout << "] [count=" << record.count << "]\n";
+}
+
 void program_body( const string& sample_directory )
 {
-  optional<Synthesizer> synth;
-  {
-    GlobalScopeTimer<Timer::Category::InitSynth> timer;
-    synth.emplace( sample_directory );
-  }
+  Synthesizer synth { sample_directory };
+
+  /* per-event latency, which is what stalls the event loop */
+  Timer::Record key_press {}, shallow_key_press {}, chord_key_press {}, key_release {}, render {};
+
+  vector<wav_frame_t> block( BLOCK_SIZE );
+
+  auto render_block = [&] {
+    RecordScopeTimer<Timer::Category::AdvanceSample> timer { render };
+    synth.render( { block.data(), block.size() } );
+  };
 
   for ( unsigned int i = 0; i < 64; i++ ) {
     {
-      GlobalScopeTimer<Timer::Category::KeyDown> timer;
-      synth->add_key_press( i + 22, 80 );
+      RecordScopeTimer<Timer::Category::KeyDown> timer { key_press };
+      synth.add_key_press( i + 22, 80 );
     }
 
-    {
-      GlobalScopeTimer<Timer::Category::AdvanceSample> timer;
-      synth->advance_sample();
-    }
+    render_block();
   }
 
   for ( unsigned int i = 0; i < 64; i++ ) {
     {
-      GlobalScopeTimer<Timer::Category::GetWav> timer;
-      synth->add_shallow_key_press( i + 22, 1 );
+      RecordScopeTimer<Timer::Category::GetWav> timer { shallow_key_press };
+      synth.add_shallow_key_press( i + 22, 1 );
     }
 
     {
-      GlobalScopeTimer<Timer::Category::GetWav> timer;
-      synth->add_shallow_key_press( i + 22 + 1, 1 );
+      RecordScopeTimer<Timer::Category::GetWav> timer { shallow_key_press };
+      synth.add_shallow_key_press( i + 22 + 1, 1 );
     }
 
-    {
-      GlobalScopeTimer<Timer::Category::AdvanceSample> timer;
-      synth->advance_sample();
+    render_block();
+  }
+
+  /* fast chords: every note arrives before the next block is rendered */
+  for ( unsigned int i = 0; i < 64 - CHORD_SIZE; i += CHORD_SIZE ) {
+    for ( unsigned int j = 0; j < CHORD_SIZE; j++ ) {
+      RecordScopeTimer<Timer::Category::KeyDown> timer { chord_key_press };
+      synth.add_key_press( i + j + 22, 100 );
     }
+
+    render_block();
   }
 
   for ( unsigned int i = 0; i < 64; i++ ) {
     {
-      GlobalScopeTimer<Timer::Category::KeyUp> timer;
-      synth->add_key_release( i + 22, 80 );
+      RecordScopeTimer<Timer::Category::KeyUp> timer { key_release };
+      synth.add_key_release( i + 22, 80 );
     }
 
-    {
-      GlobalScopeTimer<Timer::Category::AdvanceSample> timer;
-      synth->advance_sample();
-    }
+    render_block();
   }
 
   global_timer().summary( cout );
+
+  cout << "\nPer-event latency\n-----------------\n\n";
+  print_latency( "Key press", key_press );
+  print_latency( "Shallow key press", shallow_key_press );
+  print_latency( "Key press in chord", chord_key_press );
+  print_latency( "Key release", key_release );
+  print_latency( "Render " + to_string( BLOCK_SIZE ) + " frames", render );
+  cout << "\n   Voices still sounding: " << synth.active_voices() << "\n";
 }
 
 int main( int argc, char* argv[] )
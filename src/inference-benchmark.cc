@@ -0,0 +1,129 @@
+#include "dnn_types.hh"
+#include "dynamic_network.hh"
+#include "inference.hh"
+#include "randomize_network.hh"
+#include "timer.hh"
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string_view>
+
+using namespace std;
+
+// Roughly how many multiply-adds to spend on each measurement
+static constexpr double work_per_measurement = 2e8;
+
+template<NetworkT Network, int batch_size, Epilogue epilogue>
+static double ns_per_inference( const Network& nn )
+{
+  using Infer = NetworkInference<Network, batch_size, epilogue>;
+
+  auto input = make_unique<typename Infer::Input>();
+  input->setRandom();
+  auto infer = make_unique<Infer>();
+
+  const size_t iterations = max( 10.0, work_per_measurement / ( Network::num_params * batch_size ) );
+
+  infer->apply( nn, *input ); /* warm up */
+
+  const uint64_t start = Timer::timestamp_ns();
+  for ( size_t i = 0; i < iterations; i++ ) {
+    infer->apply( nn, *input );
+  }
+  const uint64_t elapsed_ns = Timer::timestamp_ns() - start;
+
+  return double( elapsed_ns ) / iterations;
+}
+
+// The same network, with its shape known only at runtime
+template<NetworkT Network, int batch_size>
+static double ns_per_dynamic_inference( const Network& nn )
+{
+  using Infer = NetworkInference<Network, batch_size>;
+  using T = typename Network::type;
+
+  const DynamicNetwork<T> dynamic { nn };
+  auto input = make_unique<typename Infer::Input>();
+  input->setRandom();
+  DynamicNetworkInference<T, batch_size> infer { dynamic };
+
+  const size_t iterations = max( 10.0, work_per_measurement / ( Network::num_params * batch_size ) );
+
+  infer.apply( dynamic, *input ); /* warm up */
+
+  const uint64_t start = Timer::timestamp_ns();
+  for ( size_t i = 0; i < iterations; i++ ) {
+    infer.apply( dynamic, *input );
+  }
+  const uint64_t elapsed_ns = Timer::timestamp_ns() - start;
+
+  return double( elapsed_ns ) / iterations;
+}
+
+template<NetworkT Network, int batch_size>
+static void benchmark( const Network& nn, const string_view name )
+{
+  const double two_pass = ns_per_inference<Network, batch_size, Epilogue::TwoPass>( nn );
+  const double fused = ns_per_inference<Network, batch_size, Epilogue::Fused>( nn );
+  const double dynamic = ns_per_dynamic_inference<Network, batch_size>( nn );
+
+  cout << "   " << name << string( 36 - name.size(), ' ' ) << "batch=" << setw( 3 ) << batch_size;
+  cout << "   two-pass=";
+  Timer::pp_ns( cout, two_pass );
+  cout << "   fused=";
+  Timer::pp_ns( cout, fused );
+  cout << "   speedup=" << setprecision( 2 ) << two_pass / fused << "x";
+  cout << "   dynamic=";
+  Timer::pp_ns( cout, dynamic );
+  cout << "\n";
+}
+
+template<NetworkT Network>
+static void benchmark( const string_view name )
+{
+  RandomState rng;
+  auto nn = make_unique<Network>();
+  randomize_network( *nn, rng );
+
+  benchmark<Network, 1>( *nn, name );
+  benchmark<Network, BATCH_SIZE>( *nn, name );
+}
+
+void program_body()
+{
+  cout << "Inference time per batch, two-pass (bias, then activation) vs. fused epilogue,\n";
+  cout << "and fused with the shape known only at runtime (DynamicNetwork)\n\n";
+
+  benchmark<DNN>( "DNN" );
+  benchmark<DNN_timestamp>( "DNN_timestamp" );
+  benchmark<DNN_tempo>( "DNN_tempo" );
+  benchmark<DNN_period>( "DNN_period" );
+  benchmark<DNN_period_16>( "DNN_period_16" );
+  benchmark<DNN_period_phase>( "DNN_period_phase" );
+  benchmark<DNN_piano_roll_rhythm_prediction>( "DNN_piano_roll_rhythm_prediction" );
+  benchmark<DNN_piano_roll_octave_prediction>( "DNN_piano_roll_octave_prediction" );
+  benchmark<DNN_piano_roll_compressor>( "DNN_piano_roll_compressor" );
+  benchmark<DNN_piano_roll_prediction>( "DNN_piano_roll_prediction" );
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -13,7 +13,44 @@ using namespace chrono;
 
 struct PeriodPredictorData
 {
+  using Infer = NetworkInference<DNN_period_16, 1>;
+  using BatchInfer = NetworkInference<DNN_period_16, PeriodPredictor::MAX_CANDIDATES>;
+  using Quantized = DNN_period_16::Quantized<int8_t>;
+  using QuantizedInfer = NetworkInference<Quantized, 1>;
+  using QuantizedBatchInfer = NetworkInference<Quantized, PeriodPredictor::MAX_CANDIDATES>;
+
   DNN_period_16 network {};
+
+  /* set if the file has int8 weights, which are then used as they are */
+  unique_ptr<Quantized> quantized {};
+
+  /* workspaces, allocated once so that predictions don't touch the heap */
+  unique_ptr<Infer> infer { make_unique<Infer>() };
+  unique_ptr<BatchInfer> batch_infer { make_unique<BatchInfer>() };
+  unique_ptr<BatchInfer::Input> batch_input { make_unique<BatchInfer::Input>() };
+  unique_ptr<QuantizedInfer> quantized_infer {};
+  unique_ptr<QuantizedBatchInfer> quantized_batch_infer {};
+
+  /* run whichever network was loaded */
+  const Infer::Output& apply( const Infer::Input& input )
+  {
+    if ( quantized ) {
+      quantized_infer->apply( *quantized, input );
+      return quantized_infer->output();
+    }
+    infer->apply( network, input );
+    return infer->output();
+  }
+
+  const BatchInfer::Output& apply( const BatchInfer::Input& input )
+  {
+    if ( quantized ) {
+      quantized_batch_infer->apply( *quantized, input );
+      return quantized_batch_infer->output();
+    }
+    batch_infer->apply( network, input );
+    return batch_infer->output();
+  }
 };
 
 PeriodPredictor::PeriodPredictor( const string& filename )
@@ -23,29 +60,92 @@ PeriodPredictor::PeriodPredictor( const string& filename )
 
   {
     ReadOnlyFile dnn_on_disk { filename };
-    Parser parser { dnn_on_disk };
-    parser.object( nn );
+    if ( NetworkBinary::is_binary( dnn_on_disk )
+         and NetworkBinary::weight_encoding( dnn_on_disk ) == NetworkBinary::WeightEncoding::Int8 ) {
+      data_->quantized = make_unique<PeriodPredictorData::Quantized>();
+      data_->quantized_infer = make_unique<PeriodPredictorData::QuantizedInfer>();
+      data_->quantized_batch_infer = make_unique<PeriodPredictorData::QuantizedBatchInfer>();
+      NetworkBinary::parse( *data_->quantized, dnn_on_disk );
+    } else {
+      NetworkBinary::load( nn, dnn_on_disk );
+    }
   }
 }
 
 float PeriodPredictor::predict_period( const std::array<float, 16>& past_timestamps )
 {
-  using Infer = NetworkInference<DNN_period_16, 1>;
-  using Input = typename Infer::Input;
+  using Input = typename PeriodPredictorData::Infer::Input;
   Input input( past_timestamps.data() );
-  Infer infer;
-  infer.apply( data_->network, input );
-  float period = infer.output()( 0 );
+  float period = data_->apply( input )( 0 );
   return period;
 }
 
+void PeriodPredictor::predict_periods( const vector<array<float, 16>>& histories, vector<float>& periods )
+{
+  auto& input = *data_->batch_input;
+
+  periods.resize( histories.size() );
+
+  for ( size_t first = 0; first < histories.size(); first += MAX_CANDIDATES ) {
+    const size_t count = min( MAX_CANDIDATES, histories.size() - first );
+    for ( size_t i = 0; i < count; i++ ) {
+      for ( size_t j = 0; j < histories[first + i].size(); j++ ) {
+        input( i, j ) = histories[first + i][j];
+      }
+    }
+
+    const auto& output = data_->apply( input );
+
+    for ( size_t i = 0; i < count; i++ ) {
+      periods[first + i] = output( i, 0 );
+    }
+  }
+}
+
 PeriodPredictor::~PeriodPredictor() = default;
 
 struct OctavePredictorData
 {
+  using Infer = NetworkInference<DNN_piano_roll_octave_prediction, 1>;
+  using BatchInfer = NetworkInference<DNN_piano_roll_octave_prediction, OctavePredictor::MAX_CANDIDATES>;
+  using Train = NetworkTraining<DNN_piano_roll_octave_prediction, 1>;
+
   DNN_piano_roll_octave_prediction network {};
+
+  /* workspaces, allocated once so that predictions don't touch the heap */
+  unique_ptr<Infer> infer { make_unique<Infer>() };
+  unique_ptr<BatchInfer> batch_infer { make_unique<BatchInfer>() };
+  unique_ptr<Infer::Input> input { make_unique<Infer::Input>() };
+  unique_ptr<BatchInfer::Input> batch_input { make_unique<BatchInfer::Input>() };
+  unique_ptr<Train> train { make_unique<Train>() };
 };
 
+/* lay out the history window key-major in one input row; slots before the history are 0.5 */
+template<class Row>
+static void encode_octave_history( const vector<OctavePredictor::NoteValuesInTimeslot>& notes, Row&& row )
+{
+  ssize_t offset = PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH - notes.size();
+  for ( size_t time = 0; time < PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH; time++ ) {
+    const OctavePredictor::NoteValuesInTimeslot* values = nullptr;
+    if ( (ssize_t)time > offset ) {
+      values = &notes[time - offset];
+    }
+    for ( size_t key = 0; key < PIANO_ROLL_OCTAVE_NUMBER_OF_NOTES; key++ ) {
+      row( key * PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH + time ) = values ? ( *values )[key] : 0.5;
+    }
+  }
+}
+
+template<class Row>
+static OctavePredictor::NoteValuesInTimeslot decode_octave_values( const Row& row )
+{
+  OctavePredictor::NoteValuesInTimeslot values;
+  for ( size_t i = 0; i < values.size(); i++ ) {
+    values[i] = row( i ) > 0.5;
+  }
+  return values;
+}
+
 OctavePredictor::OctavePredictor( const std::string& filename )
 {
   data_ = make_unique<OctavePredictorData>();
@@ -53,8 +153,7 @@ OctavePredictor::OctavePredictor( const std::string& filename )
 
   {
     ReadOnlyFile dnn_on_disk { filename };
-    Parser parser { dnn_on_disk };
-    parser.object( nn );
+    NetworkBinary::load( nn, dnn_on_disk );
   }
 }
 
@@ -105,66 +204,45 @@ OctavePredictor::Timeslot OctavePredictor::predict_next_timeslot( const std::vec
 OctavePredictor::NoteValuesInTimeslot OctavePredictor::predict_next_note_values(
   const std::vector<NoteValuesInTimeslot>& notes )
 {
-  using Infer = NetworkInference<DNN_piano_roll_octave_prediction, 1>;
-  using Output = Infer::Output;
-  using Input = Infer::Input;
+  encode_octave_history( notes, data_->input->row( 0 ) );
+  data_->infer->apply( data_->network, *data_->input );
+  return decode_octave_values( data_->infer->output().row( 0 ) );
+}
 
-  Input input;
-  ssize_t offset = PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH - notes.size();
-  for ( size_t time = 0; time < PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH; time++ ) {
-    optional<NoteValuesInTimeslot> values = nullopt;
-    if ( (ssize_t)time > offset ) {
-      values = notes[time - offset];
-    }
-    for ( size_t key = 0; key < PIANO_ROLL_OCTAVE_NUMBER_OF_NOTES; key++ ) {
-      if ( values.has_value() ) {
-        input( key * PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH + time ) = ( *values )[key];
-      } else {
-        input( key * PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH + time ) = 0.5;
-      }
+void OctavePredictor::predict_next_note_values( const vector<vector<NoteValuesInTimeslot>>& candidates,
+                                                vector<NoteValuesInTimeslot>& predictions )
+{
+  auto& input = *data_->batch_input;
+  auto& infer = *data_->batch_infer;
+
+  predictions.resize( candidates.size() );
+
+  for ( size_t first = 0; first < candidates.size(); first += MAX_CANDIDATES ) {
+    const size_t count = min( MAX_CANDIDATES, candidates.size() - first );
+    for ( size_t i = 0; i < count; i++ ) {
+      encode_octave_history( candidates[first + i], input.row( i ) );
     }
-  }
 
-  Infer infer;
-  infer.apply( data_->network, input );
-  Output output = infer.output();
+    infer.apply( data_->network, input );
 
-  NoteValuesInTimeslot values;
-  for ( size_t i = 0; i < values.size(); i++ ) {
-    values[i] = output( i ) > 0.5;
+    for ( size_t i = 0; i < count; i++ ) {
+      predictions[first + i] = decode_octave_values( infer.output().row( i ) );
+    }
   }
-  return values;
 }
+
 void OctavePredictor::train_next_note_values( const std::vector<NoteValuesInTimeslot>& notes,
                                               const NoteValuesInTimeslot& next )
 {
-  using Infer = NetworkInference<DNN_piano_roll_octave_prediction, 1>;
-  using Input = typename Infer::Input;
-  using Output = typename Infer::Output;
-  using Train = NetworkTraining<DNN_piano_roll_octave_prediction, 1>;
+  using Output = typename OctavePredictorData::Infer::Output;
 
-  Input input;
-  ssize_t offset = PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH - notes.size();
-  for ( size_t time = 0; time < PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH; time++ ) {
-    optional<NoteValuesInTimeslot> values = nullopt;
-    if ( (ssize_t)time > offset ) {
-      values = notes[time - offset];
-    }
-    for ( size_t key = 0; key < PIANO_ROLL_OCTAVE_NUMBER_OF_NOTES; key++ ) {
-      if ( values.has_value() ) {
-        input( key * PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH + time ) = ( *values )[key];
-      } else {
-        input( key * PIANO_ROLL_OCTAVE_HISTORY_WINDOW_LENGTH + time ) = 0.5;
-      }
-    }
-  }
+  encode_octave_history( notes, data_->input->row( 0 ) );
 
-  Train train;
   Output expected;
   for ( size_t i = 0; i < next.size(); i++ ) {
     expected( i ) = next[i];
   }
 
-  train.train(
-    data_->network, input, [&expected]( const auto& predicted ) { return predicted - expected; }, 0.01 );
+  data_->train->train(
+    data_->network, *data_->input, [&expected]( const auto& predicted ) { return predicted - expected; }, 0.01 );
 }
@@ -1,12 +1,14 @@
 #pragma once
 
 #include "autoencoder.hh"
+#include "binary_network.hh"
 #include "dnn_types.hh"
 #include "mmap.hh"
 #include "piano_roll.hh"
 #include "serdes.hh"
 #include "training.hh"
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <memory>
@@ -19,6 +21,8 @@ struct PeriodPredictorData;
 class PeriodPredictor
 {
 public:
+  static constexpr size_t MAX_CANDIDATES = 16;
+
   PeriodPredictor( const std::string& filename );
   ~PeriodPredictor();
 
@@ -27,16 +31,34 @@ public:
 
   float predict_period( const std::array<float, 16>& past_timestamps );
 
+  // Score many histories, MAX_CANDIDATES per matrix multiplication. `periods` is resized to
+  // match; reusing it across calls avoids any allocation.
+  void predict_periods( const std::vector<std::array<float, 16>>& histories, std::vector<float>& periods );
+
 private:
   std::unique_ptr<PeriodPredictorData> data_ {};
 };
 
 class SimpleNN
 {
+public:
+  static constexpr size_t MAX_CANDIDATES = 16;
+
 private:
   using Predictor = DNN_piano_roll_prediction;
+  using Infer = NetworkInference<Predictor, 1>;
+  using BatchInfer = NetworkInference<Predictor, MAX_CANDIDATES>;
+  using Train = NetworkTraining<Predictor, 1>;
+
   std::unique_ptr<Predictor> predictor_;
 
+  /* workspaces, allocated once so that predictions don't touch the heap */
+  std::unique_ptr<Infer> infer_ { std::make_unique<Infer>() };
+  std::unique_ptr<BatchInfer> batch_infer_ { std::make_unique<BatchInfer>() };
+  std::unique_ptr<typename Infer::Input> input_ { std::make_unique<typename Infer::Input>() };
+  std::unique_ptr<typename BatchInfer::Input> batch_input_ { std::make_unique<typename BatchInfer::Input>() };
+  std::unique_ptr<Train> train_ { std::make_unique<Train>() };
+
 public:
   using Key = uint8_t;
   using Time = std::chrono::steady_clock::time_point;
@@ -65,13 +87,76 @@ public:
   using Roll = std::vector<Column>;
   static constexpr size_t HISTORY = PIANO_ROLL_HISTORY;
 
+  // The last HISTORY columns of a live piano roll, for streaming prediction. The newest column is
+  // the timeslot still being played; advance() closes it and opens the next. The columns are kept
+  // in a ring buffer, and the network inputs are updated in place (one column in, one out), so a
+  // prediction or training step does nothing but the network's own work.
+  class Window
+  {
+  public:
+    Window()
+    {
+      input_->setConstant( PianoRollEvent::Unknown );
+      previous_input_->setConstant( PianoRollEvent::Unknown );
+    }
+
+    // Replace the newest column (e.g. as keys are pressed during the timeslot)
+    void set_current( const Column& column )
+    {
+      columns_[newest_] = column;
+      write_newest( *input_, column );
+    }
+
+    // Start the next timeslot, initially a copy of the current one
+    void advance()
+    {
+      *previous_input_ = *input_;
+
+      auto* keys = input_->data();
+      for ( size_t key = 0; key < 88; key++, keys += HISTORY ) {
+        std::copy( keys + 1, keys + HISTORY, keys );
+      }
+
+      const Column& current = columns_[newest_];
+      newest_ = ( newest_ + 1 ) % HISTORY;
+      columns_[newest_] = current;
+      write_newest( *input_, current );
+      timeslots_++;
+    }
+
+    const Column& current() const { return columns_[newest_]; }
+
+    // The i-th of the last HISTORY columns, oldest first (columns from before the start are empty)
+    const Column& column( const size_t i ) const { return columns_[( newest_ + 1 + i ) % HISTORY]; }
+
+    // Timeslots seen so far, including the current one
+    size_t timeslots() const { return timeslots_; }
+
+  private:
+    friend class SimpleNN;
+
+    std::array<Column, HISTORY> columns_ {};
+    size_t newest_ = HISTORY - 1;
+    size_t timeslots_ = 1;
+
+    /* the last HISTORY columns, and the HISTORY before the current one, laid out as by encode_history */
+    std::unique_ptr<typename Infer::Input> input_ { std::make_unique<typename Infer::Input>() };
+    std::unique_ptr<typename Infer::Input> previous_input_ { std::make_unique<typename Infer::Input>() };
+
+    static void write_newest( typename Infer::Input& input, const Column& column )
+    {
+      for ( size_t key = 0; key < 88; key++ ) {
+        input( key * HISTORY + HISTORY - 1 ) = column[key];
+      }
+    }
+  };
+
   SimpleNN( const std::string& predictor_file )
     : predictor_( std::make_unique<Predictor>() )
   {
     {
       ReadOnlyFile dnn_on_disk { predictor_file };
-      Parser parser { dnn_on_disk };
-      parser.object( *predictor_ );
+      NetworkBinary::load( *predictor_, dnn_on_disk );
     }
   }
   ~SimpleNN() = default;
@@ -122,95 +207,60 @@ public:
 
   Column predict_next_note_values( const Roll& roll )
   {
-    using namespace std;
-    using Infer = NetworkInference<Predictor, 1>;
+    encode_history( roll, input_->row( 0 ) );
+    infer_->apply( *predictor_, *input_ );
+    return decode_column( infer_->output().row( 0 ) );
+  }
 
-    using Input = typename Infer::Input;
-    using Output = typename Infer::Output;
+  Column predict_next_note_values( const Window& window )
+  {
+    infer_->apply( *predictor_, *window.input_ );
+    return decode_column( infer_->output().row( 0 ) );
+  }
 
-    auto unknown = make_unique<Output>();
-    for ( ssize_t i = 0; i < unknown->size(); i++ ) {
-      ( *unknown )( i ) = PianoRollEvent::Unknown;
-    }
-    auto inputs = make_unique<std::vector<Output>>();
+  // Score many candidate histories, MAX_CANDIDATES per matrix multiplication. `predictions` is
+  // resized to match; reusing it across calls avoids any allocation.
+  void predict_next_note_values( const std::vector<Roll>& candidates, std::vector<Column>& predictions )
+  {
+    predictions.resize( candidates.size() );
 
-    if ( roll.size() < HISTORY )
-      for ( size_t i = 0; i < HISTORY - roll.size(); i++ ) {
-        inputs->push_back( *unknown );
+    for ( size_t first = 0; first < candidates.size(); first += MAX_CANDIDATES ) {
+      const size_t count = std::min( MAX_CANDIDATES, candidates.size() - first );
+      for ( size_t i = 0; i < count; i++ ) {
+        encode_history( candidates[first + i], batch_input_->row( i ) );
       }
 
-    for ( const auto& column : roll ) {
-      Output current;
-      for ( size_t i = 0; i < column.size(); i++ ) {
-        current( i ) = column[i];
-      }
-      inputs->push_back( current );
-    }
+      batch_infer_->apply( *predictor_, *batch_input_ );
 
-    auto combined_input = make_unique<Input>();
-    for ( size_t column = 0; column < inputs->size(); column++ ) {
-      for ( size_t row = 0; row < 88; row++ ) {
-        ( *combined_input )( row * HISTORY + column ) = ( *inputs )[column]( row );
+      for ( size_t i = 0; i < count; i++ ) {
+        predictions[first + i] = decode_column( batch_infer_->output().row( i ) );
       }
     }
-
-    auto infer = make_unique<Infer>();
-    infer->apply( *predictor_, *combined_input );
-
-    auto output = infer->output();
-
-    Column column;
-    for ( size_t i = 0; i < column.size(); i++ ) {
-      column[i] = output( i ) > 0.5;
-    }
-
-    return column;
   }
 
   void train_next_note_values( const std::vector<Column>& roll, const Column& next )
   {
-    using namespace std;
-    using Infer = NetworkInference<Predictor, 1>;
-    using Train = NetworkTraining<Predictor, 1>;
-
-    using Input = typename Infer::Input;
-    using Output = typename Infer::Output;
-
-    auto unknown = make_unique<Output>();
-    for ( ssize_t i = 0; i < unknown->size(); i++ ) {
-      ( *unknown )( i ) = PianoRollEvent::Unknown;
-    }
-    auto inputs = make_unique<std::vector<Output>>();
-
-    if ( roll.size() < HISTORY )
-      for ( size_t i = 0; i < HISTORY - roll.size(); i++ ) {
-        inputs->push_back( *unknown );
-      }
+    encode_history( roll, input_->row( 0 ) );
+    train( *input_, next );
+  }
 
-    for ( const auto& column : roll ) {
-      Output current;
-      for ( size_t i = 0; i < column.size(); i++ ) {
-        current( i ) = column[i];
-      }
-      inputs->push_back( current );
-    }
+  // Train on the window's current timeslot, as the prediction from the ones before it
+  void train_next_note_values( const Window& window ) { train( *window.previous_input_, window.current() ); }
 
-    auto combined_input = make_unique<Input>();
-    for ( size_t column = 0; column < inputs->size(); column++ ) {
-      for ( size_t row = 0; row < 88; row++ ) {
-        ( *combined_input )( row * HISTORY + column ) = ( *inputs )[column]( row );
-      }
-    }
+private:
+  void train( const typename Infer::Input& input, const Column& next )
+  {
+    using namespace std;
+    using Output = typename Infer::Output;
 
     Output expected;
     for ( size_t i = 0; i < next.size(); i++ ) {
       expected( i ) = next[i];
     }
 
-    auto train = make_unique<Train>();
-    train->train(
+    train_->train(
       *predictor_,
-      *combined_input,
+      input,
       [&]( const auto& predicted ) {
         auto sigmoid = []( const auto x ) { return 1.0 / ( 1.0 + exp( -x ) ); };
         auto one_minus_x = []( const auto x ) { return 1.0 - x; };
@@ -227,6 +277,32 @@ public:
       },
       0.01 );
   }
+
+  // Lay out the last HISTORY columns of `roll` key-major in one input row; columns from before
+  // the start of the roll are Unknown
+  template<class Row>
+  static void encode_history( const Roll& roll, Row&& row )
+  {
+    const size_t used = std::min( roll.size(), HISTORY );
+    const size_t missing = HISTORY - used;
+    const Column* columns = roll.data() + roll.size() - used;
+
+    for ( size_t column = 0; column < HISTORY; column++ ) {
+      for ( size_t key = 0; key < 88; key++ ) {
+        row( key * HISTORY + column ) = column < missing ? PianoRollEvent::Unknown : columns[column - missing][key];
+      }
+    }
+  }
+
+  template<class Row>
+  static Column decode_column( const Row& row )
+  {
+    Column column;
+    for ( size_t i = 0; i < column.size(); i++ ) {
+      column[i] = row( i ) > 0.5;
+    }
+    return column;
+  }
 };
 
 struct OctavePredictorData;
@@ -258,6 +334,7 @@ public:
     {}
   };
   using NoteValuesInTimeslot = std::array<bool, 12>;
+  static constexpr size_t MAX_CANDIDATES = 16;
 
   OctavePredictor( const std::string& filename );
   ~OctavePredictor();
@@ -265,6 +342,12 @@ public:
   Timeslot predict_next_timeslot( const std::vector<KeyPress>& timestamps );
 
   NoteValuesInTimeslot predict_next_note_values( const std::vector<NoteValuesInTimeslot>& notes );
+
+  // Score many candidate histories, MAX_CANDIDATES per matrix multiplication. `predictions` is
+  // resized to match; reusing it across calls avoids any allocation.
+  void predict_next_note_values( const std::vector<std::vector<NoteValuesInTimeslot>>& candidates,
+                                 std::vector<NoteValuesInTimeslot>& predictions );
+
   void train_next_note_values( const std::vector<NoteValuesInTimeslot>& notes, const NoteValuesInTimeslot& next );
 
 private:
@@ -1,7 +1,8 @@
 #include "backprop.hh"
+#include "batch_queue.hh"
 #include "dnn_types.hh"
 #include "inference.hh"
-#include "midi_file.hh"
+#include "midi_corpus.hh"
 #include "randomize_network.hh"
 #include "serdes.hh"
 #include "training.hh"
@@ -11,13 +12,14 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 using namespace std;
 
-// Input generation parameters
-static auto prng = get_random_engine();
-static vector<MidiFile> midi_files {};
+// Input generation parameters (the random engine is per thread, for the BatchQueue's producer)
+static thread_local auto prng = get_random_engine();
+static unique_ptr<MidiCorpus> midi_files {};
 
 // Types
 #define HISTORY 64
@@ -60,17 +62,24 @@ Output pd_loss( const Output& expected, const Output& predicted )
   return pd;
 }
 
-void generate_datum( Input& input, Output& output, string& name )
+// A batch of training examples, prepared ahead of the training loop by a BatchQueue
+struct Batch
+{
+  Input input {};
+  Output expected {};
+  string name {};
+};
+
+// Fill a batch with random examples (called on the BatchQueue's producer thread)
+void generate_datum( Batch& batch )
 {
   for ( size_t row = 0; row < BATCH; row++ ) {
-    const auto& midi = midi_files[uniform_int_distribution<size_t>( 0, midi_files.size() - 1 )( prng )];
-    name = midi.name;
-    const auto roll = midi.piano_roll();
+    const auto& midi = ( *midi_files )[uniform_int_distribution<size_t>( 0, midi_files->size() - 1 )( prng )];
+    batch.name = midi.name;
+    const auto& roll = midi.piano_roll();
     const size_t index = uniform_int_distribution<size_t>( 0, roll.size() - 1 )( prng );
-    for ( size_t i = 21; i <= 108; i++ ) {
-      input( row, i - 21 ) = roll[index][i] > 0.5;
-      output( row, i - 21 ) = roll[index][i] > 0.5;
-    }
+    roll[index].unpack( 21, batch.input.row( row ) );
+    batch.expected.row( row ) = batch.input.row( row );
   }
 };
 
@@ -85,18 +94,15 @@ void program_body( ostream& outstream )
   RandomState rng;
   randomize_network( nn, rng );
 
-  auto input_ptr = make_unique<Input>();
-  Input& input = *input_ptr;
-  auto expected_ptr = make_unique<Output>();
-  Output& expected = *expected_ptr;
   auto train = make_unique<Training>();
 
+  /* the next batch is prepared while this one trains */
+  BatchQueue<Batch> batches { generate_datum };
+
   Visualizer viz( loss, pd_loss );
   do {
-    auto infer = make_unique<Infer>();
-    string name;
-    generate_datum( input, expected, name );
-    viz.train( input, expected );
+    const Batch& batch = batches.next();
+    viz.train( batch.input, batch.expected );
   } while ( true );
 
   string serialized_nn;
@@ -127,31 +133,19 @@ int main( int argc, char* argv[] )
     return EXIT_FAILURE;
   }
 
-  string midi_directory = argv[1];
-
   try {
-    for ( const auto& entry : filesystem::directory_iterator( midi_directory ) ) {
-      if ( entry.path().extension() == ".mid" ) {
-        cout << "Using file: " << entry.path() << "\n";
-        midi_files.emplace_back( MidiFile( entry.path() ) );
-        if ( midi_files.back().tracks().size() == 0 ) {
-          cout << "No tracks found; skipping!"
-               << "\n";
-          midi_files.pop_back();
-        }
-      }
-    }
+    midi_files = make_unique<MidiCorpus>( argv[1] );
   } catch ( const filesystem::filesystem_error& e ) {
     cerr << "Error finding midi files:\n";
     cerr << e.what() << endl;
     return EXIT_FAILURE;
   }
 
-  if ( midi_files.empty() ) {
+  if ( midi_files->empty() ) {
     cerr << "No midi files found!" << endl;
     return EXIT_FAILURE;
   }
-  cout << "Got " << midi_files.size() << " midi files.\n";
+  cout << "Got " << midi_files->size() << " midi files.\n";
 
   string filename = argv[2];
 
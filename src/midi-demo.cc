@@ -40,21 +40,17 @@ void generate_datum( array<Single, HISTORY>& input, Single& output, string& name
 {
   const auto& midi = midi_files[uniform_int_distribution<size_t>( 0, midi_files.size() - 1 )( prng )];
   name = midi.name;
-  const PianoRoll<128>& roll = midi.piano_roll();
+  const PackedPianoRoll& roll = midi.piano_roll();
   const ssize_t start_index = uniform_int_distribution<ssize_t>( 0, roll.size() - 1 )( prng ) - HISTORY;
 
   for ( size_t i = 0; i < HISTORY; i++ ) {
-    for ( size_t key = 0; key < 88; key++ ) {
-      if ( (ssize_t)i + start_index < 0 ) {
-        input[i][key] = PianoRollEvent::Unknown;
-      } else {
-        input[i][key] = roll[i + start_index][key + 21];
-      }
+    if ( (ssize_t)i + start_index < 0 ) {
+      input[i].setConstant( PianoRollEvent::Unknown );
+    } else {
+      roll[i + start_index].unpack( 21, input[i] );
     }
   }
-  for ( size_t key = 0; key < 88; key++ ) {
-    output[key] = roll[start_index + HISTORY][key + 21];
-  }
+  roll[start_index + HISTORY].unpack( 21, output );
 };
 
 template<size_t N>
@@ -123,13 +119,9 @@ void program_body( const string& filename )
 
       for ( size_t i = PIANO_ROLL_HISTORY; i < columns; i++ ) {
         for ( size_t j = 0; j < PIANO_ROLL_HISTORY; j++ ) {
-          for ( size_t k = 0; k < 88; k++ ) {
-            input( k * PIANO_ROLL_HISTORY + j ) = roll[i - PIANO_ROLL_HISTORY + j][k];
-          }
-        }
-        for ( size_t k = 0; k < 88; k++ ) {
-          expected( k ) = roll[i][k];
+          roll[i - PIANO_ROLL_HISTORY + j].unpack( 0, input( Eigen::seqN( j, 88, PIANO_ROLL_HISTORY ) ) );
         }
+        roll[i].unpack( 0, expected );
 
         time_point start = steady_clock::now();
         infer.apply( nn, input );
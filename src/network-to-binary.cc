@@ -0,0 +1,106 @@
+#include "binary_network.hh"
+#include "dnn_types.hh"
+#include "mmap.hh"
+#include "timer.hh"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string_view>
+
+using namespace std;
+
+// Convert a network from the Serializer format to the binary format (and time loading both)
+template<NetworkT Network>
+static void convert( const string& input_filename, ostream& output )
+{
+  auto nn = make_unique<Network>();
+
+  {
+    ReadOnlyFile dnn_on_disk { input_filename };
+
+    const uint64_t start = Timer::timestamp_ns();
+    Parser parser { dnn_on_disk };
+    parser.object( *nn );
+    cout << "Parsed Serializer format (with roundtrip check) in ";
+    Timer::pp_ns( cout, Timer::timestamp_ns() - start );
+    cout << ".\n";
+  }
+
+  const string binary = NetworkBinary::serialize( *nn );
+
+  {
+    auto check = make_unique<Network>();
+    const uint64_t start = Timer::timestamp_ns();
+    NetworkBinary::parse( *check, binary );
+    cout << "Parsed binary format (checksum only) in ";
+    Timer::pp_ns( cout, Timer::timestamp_ns() - start );
+    cout << ".\n";
+
+    NetworkBinary::parse( *check, binary, true );
+  }
+
+  output << binary;
+  cout << "Output is " << binary.size() << " bytes.\n";
+}
+
+static bool convert( const string_view type, const string& input_filename, ostream& output )
+{
+  if ( type == "DNN" ) {
+    convert<DNN>( input_filename, output );
+  } else if ( type == "DNN_timestamp" ) {
+    convert<DNN_timestamp>( input_filename, output );
+  } else if ( type == "DNN_tempo" ) {
+    convert<DNN_tempo>( input_filename, output );
+  } else if ( type == "DNN_period" ) {
+    convert<DNN_period>( input_filename, output );
+  } else if ( type == "DNN_period_16" ) {
+    convert<DNN_period_16>( input_filename, output );
+  } else if ( type == "DNN_period_phase" ) {
+    convert<DNN_period_phase>( input_filename, output );
+  } else if ( type == "DNN_piano_roll_rhythm_prediction" ) {
+    convert<DNN_piano_roll_rhythm_prediction>( input_filename, output );
+  } else if ( type == "DNN_piano_roll_octave_prediction" ) {
+    convert<DNN_piano_roll_octave_prediction>( input_filename, output );
+  } else if ( type == "DNN_piano_roll_compressor" ) {
+    convert<DNN_piano_roll_compressor>( input_filename, output );
+  } else if ( type == "DNN_piano_roll_prediction" ) {
+    convert<DNN_piano_roll_prediction>( input_filename, output );
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 4 ) {
+    cerr << "Usage: " << argv[0] << " network_type input_filename output_filename\n";
+    return EXIT_FAILURE;
+  }
+
+  ofstream output;
+  output.open( argv[3], ios::binary );
+
+  if ( !output.is_open() ) {
+    cerr << "Unable to open file '" << argv[3] << "' for writing." << endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    if ( not convert( argv[1], argv[2], output ) ) {
+      cerr << "Unknown network type '" << argv[1] << "'.\n";
+      return EXIT_FAILURE;
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -21,24 +21,35 @@ struct LayerBackPropagation
                       const WeightTimesErrorNextLayer& wte_next_layer,
                       const bool is_last )
   {
-    typename Inference::Output pd_activation_wrt_unactivated_output;
-    if ( !is_last ) {
-      pd_activation_wrt_unactivated_output = inference.output.unaryExpr(
-        []( const auto val ) -> typename Layer::type { return val > 0 ? 1.0 : leaky_constant; } );
-    } else {
-      pd_activation_wrt_unactivated_output = Inference::Output::Ones();
+    if ( is_last ) {
+      /* no activation function, so the error is the incoming gradient as it is */
+      accumulate_gradients( layer, input, wte_next_layer );
+      return;
     }
-    Error error = wte_next_layer.cwiseProduct( pd_activation_wrt_unactivated_output );
-    weight_times_error.noalias() = error * layer.weights.transpose();
 
-    bias_gradient.noalias() = error.colwise().sum();
-    weight_gradient.noalias() = input.transpose() * error;
+    /* the derivative of the leaky ReLU, applied as the error is computed */
+    error = wte_next_layer.binaryExpr( inference.output, []( const auto wte, const auto val ) {
+      return val > 0 ? wte : wte * typename Layer::type( leaky_constant );
+    } );
+    accumulate_gradients( layer, input, error );
   }
 
   // State for this layer's backpropagation
   typename Layer::Weights weight_gradient {};
   typename Layer::Biases bias_gradient {};
   WeightTimesError weight_times_error {};
+
+private:
+  // Workspace for the error of a hidden layer, kept so that differentiate() needs no temporaries
+  Error error {};
+
+  void accumulate_gradients( const Layer& layer, const typename Inference::Input& input, const Error& layer_error )
+  {
+    weight_times_error.noalias() = layer_error * layer.weights.transpose();
+
+    bias_gradient.noalias() = layer_error.colwise().sum();
+    weight_gradient.noalias() = input.transpose() * layer_error;
+  }
 };
 
 template<NetworkT Network, int batch_size, bool is_last_T>
@@ -0,0 +1,491 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dynamic_network.hh"
+#include "inference.hh"
+#include "mmap.hh"
+#include "network.hh"
+#include "quantize.hh"
+#include "serdes.hh"
+
+// A binary network format that can be used in place, e.g. straight out of a ReadOnlyFile.
+// Every field is little-endian.
+//
+//   offset  size  field
+//        0     8  magic "nnbinary"
+//        8     4  format version
+//       12     4  size of each parameter in bytes (4 = float, 8 = double)
+//       16     4  weight encoding (see WeightEncoding)
+//       20     4  number of layers
+//       24     4  number of roundtrip examples (0 if none)
+//       28     4  reserved (0)
+//       32     8  number of parameters
+//       40     8  checksum of the parameter block
+//       48     8  offset of the parameter block (a multiple of 64)
+//       56     8  offset of the roundtrip examples (0 if none)
+//       64   4*n  the n = layers + 1 layer sizes (input size, then each layer's output size)
+//
+// The parameter block is in FlatNetwork order: each layer's weights (column-major), then its
+// biases. For a QuantizedNetwork, each layer's weights are followed by its scales. The optional
+// roundtrip examples that follow are inputs, then the outputs the network produced for them when
+// it was written.
+
+namespace NetworkBinary {
+
+static constexpr std::string_view magic { "nnbinary" };
+static constexpr uint32_t version = 1;
+static constexpr size_t header_length = 64;
+static constexpr size_t parameter_alignment = 64;
+static constexpr unsigned int num_examples = 16;
+
+// How the weights are stored
+enum class WeightEncoding : uint32_t
+{
+  Plain = 0,  // the same type as the other parameters
+  Int8 = 1,   // int8_t, with one scale per output
+  Float16 = 2 // Eigen::half (scales all 1)
+};
+
+template<class Storage>
+inline constexpr WeightEncoding weight_encoding_of = WeightEncoding::Plain;
+template<>
+inline constexpr WeightEncoding weight_encoding_of<int8_t> = WeightEncoding::Int8;
+template<>
+inline constexpr WeightEncoding weight_encoding_of<Eigen::half> = WeightEncoding::Float16;
+
+// The size of a network's parameter block
+template<NetworkT Network>
+constexpr size_t parameter_bytes()
+{
+  using Layer = typename Network::Layer0;
+  using T = typename Layer::type;
+
+  size_t bytes = Layer::input_size * Layer::output_size * sizeof( typename Layer::storage_type );
+  bytes += Layer::output_size * sizeof( T ); /* biases */
+  if constexpr ( weight_encoding_of<typename Layer::storage_type> != WeightEncoding::Plain ) {
+    bytes += Layer::output_size * sizeof( T ); /* scales */
+  }
+
+  if constexpr ( not Network::is_last ) {
+    bytes += parameter_bytes<typename Network::Rest>();
+  }
+
+  return bytes;
+}
+
+// Is this the binary format (rather than the Serializer format)?
+inline bool is_binary( const std::string_view file )
+{
+  return file.substr( 0, magic.size() ) == magic;
+}
+
+// 64-bit FNV-1a over 8-byte words (then any remaining bytes)
+inline uint64_t checksum( const std::string_view data )
+{
+  constexpr uint64_t prime = 0x100000001b3;
+  uint64_t hash = 0xcbf29ce484222325;
+
+  size_t i = 0;
+  for ( ; i + sizeof( uint64_t ) <= data.size(); i += sizeof( uint64_t ) ) {
+    uint64_t word;
+    memcpy( &word, data.data() + i, sizeof( word ) );
+    hash = ( hash ^ word ) * prime;
+  }
+  for ( ; i < data.size(); i++ ) {
+    hash = ( hash ^ uint8_t( data[i] ) ) * prime;
+  }
+
+  return hash;
+}
+
+template<typename T>
+void put_integer( std::string& out, const T val )
+{
+  for ( size_t i = 0; i < sizeof( T ); i++ ) {
+    out.push_back( char( ( val >> ( i * 8 ) ) & 0xff ) );
+  }
+}
+
+template<typename T>
+T get_integer( const std::string_view in, const size_t offset )
+{
+  if ( offset + sizeof( T ) > in.size() ) {
+    throw std::runtime_error( "binary network: truncated header" );
+  }
+
+  T val = 0;
+  for ( size_t i = 0; i < sizeof( T ); i++ ) {
+    val |= T( uint8_t( in[offset + i] ) ) << ( i * 8 );
+  }
+  return val;
+}
+
+inline void require_little_endian()
+{
+  if constexpr ( std::endian::native != std::endian::little ) {
+    throw std::runtime_error( "binary network: only supported on little-endian hosts" );
+  }
+}
+
+// Check the fields that don't depend on the network's shape
+inline void check_preamble( const std::string_view file, const size_t type_size, const WeightEncoding encoding )
+{
+  require_little_endian();
+
+  if ( not is_binary( file ) ) {
+    throw std::runtime_error( "binary network: missing header" );
+  }
+
+  if ( get_integer<uint32_t>( file, 8 ) != version ) {
+    throw std::runtime_error( "binary network: unsupported version" );
+  }
+
+  if ( get_integer<uint32_t>( file, 12 ) != type_size ) {
+    throw std::runtime_error( "binary network: parameter type mismatch" );
+  }
+
+  if ( get_integer<uint32_t>( file, 16 ) != uint32_t( encoding ) ) {
+    throw std::runtime_error( "binary network: weight encoding mismatch" );
+  }
+}
+
+// The parameter block (of a known length), after checking its checksum
+inline std::string_view parameter_block( const std::string_view file, const uint64_t parameter_length )
+{
+  const uint64_t parameter_offset = get_integer<uint64_t>( file, 48 );
+  if ( parameter_offset % parameter_alignment or parameter_offset + parameter_length > file.size() ) {
+    throw std::runtime_error( "binary network: bad parameter block" );
+  }
+
+  const std::string_view parameters = file.substr( parameter_offset, parameter_length );
+  if ( checksum( parameters ) != get_integer<uint64_t>( file, 40 ) ) {
+    throw std::runtime_error( "binary network: checksum mismatch" );
+  }
+
+  return parameters;
+}
+
+// The roundtrip examples (empty if there are none), each `example_length` bytes
+inline std::string_view example_block( const std::string_view file, const size_t example_length )
+{
+  const uint32_t example_count = get_integer<uint32_t>( file, 24 );
+  const uint64_t example_offset = get_integer<uint64_t>( file, 56 );
+  if ( not example_count ) {
+    return {};
+  }
+
+  if ( example_count != num_examples or example_offset + example_count * example_length > file.size() ) {
+    throw std::runtime_error( "binary network: bad roundtrip examples" );
+  }
+
+  return file.substr( example_offset, example_count * example_length );
+}
+
+// The parts of a file, checked against the Network type
+template<NetworkT Network>
+struct Contents
+{
+  using T = typename Network::type;
+  static constexpr WeightEncoding encoding = weight_encoding_of<typename Network::Layer0::storage_type>;
+
+  std::string_view parameters {};
+  std::string_view examples {};
+
+  explicit Contents( const std::string_view file )
+  {
+    check_preamble( file, sizeof( T ), encoding );
+
+    if ( get_integer<uint32_t>( file, 20 ) != Network::num_layers
+         or get_integer<uint64_t>( file, 32 ) != Network::num_params ) {
+      throw std::runtime_error( "binary network: shape mismatch" );
+    }
+
+    check_layer_sizes<Network>( file, header_length );
+
+    parameters = parameter_block( file, parameter_bytes<Network>() );
+    examples = example_block( file, ( Network::input_size + Network::output_size ) * sizeof( T ) );
+  }
+
+  template<NetworkT SubNetwork>
+  static void check_layer_sizes( const std::string_view file, const size_t offset )
+  {
+    if ( get_integer<uint32_t>( file, offset ) != SubNetwork::Layer0::input_size ) {
+      throw std::runtime_error( "binary network: layer size mismatch" );
+    }
+
+    if constexpr ( SubNetwork::is_last ) {
+      if ( get_integer<uint32_t>( file, offset + 4 ) != SubNetwork::Layer0::output_size ) {
+        throw std::runtime_error( "binary network: layer size mismatch" );
+      }
+    } else {
+      check_layer_sizes<typename SubNetwork::Rest>( file, offset + 4 );
+    }
+  }
+
+  // Run the network on the saved examples and compare with the saved outputs
+  template<NetworkT SomeNetwork>
+  void check_roundtrip( const SomeNetwork& network ) const
+  {
+    using Infer = NetworkInference<SomeNetwork, num_examples>;
+
+    if ( examples.empty() ) {
+      throw std::runtime_error( "binary network: no roundtrip examples to check" );
+    }
+
+    auto input = std::make_unique<typename Infer::Input>();
+    auto expected_output = std::make_unique<typename Infer::Output>();
+    memcpy( input->data(), examples.data(), input->size() * sizeof( T ) );
+    memcpy( expected_output->data(),
+            examples.data() + input->size() * sizeof( T ),
+            expected_output->size() * sizeof( T ) );
+
+    auto inference = std::make_unique<Infer>();
+    inference->apply( network, *input );
+
+    if ( ( inference->output() - *expected_output ).cwiseAbs().maxCoeff() > 1e-5 ) {
+      throw std::runtime_error( "binary network: roundtrip failure" );
+    }
+  }
+};
+
+template<NetworkT SubNetwork>
+void put_layer_sizes_recursive( std::string& out )
+{
+  put_integer<uint32_t>( out, SubNetwork::Layer0::input_size );
+
+  if constexpr ( SubNetwork::is_last ) {
+    put_integer<uint32_t>( out, SubNetwork::Layer0::output_size );
+  } else {
+    put_layer_sizes_recursive<typename SubNetwork::Rest>( out );
+  }
+}
+
+template<class Matrix>
+void put_matrix( std::string& out, const Matrix& matrix )
+{
+  out.append( reinterpret_cast<const char*>( matrix.data() ), matrix.size() * sizeof( *matrix.data() ) );
+}
+
+template<NetworkT SubNetwork>
+void put_parameters( std::string& out, const SubNetwork& network )
+{
+  put_matrix( out, network.first.weights );
+  if constexpr ( weight_encoding_of<typename SubNetwork::Layer0::storage_type> != WeightEncoding::Plain ) {
+    put_matrix( out, network.first.scales );
+  }
+  put_matrix( out, network.first.biases );
+
+  if constexpr ( not SubNetwork::is_last ) {
+    put_parameters( out, network.rest );
+  }
+}
+
+// Write the network (a Network, MappedNetwork or QuantizedNetwork), optionally with roundtrip examples
+template<NetworkT Network>
+std::string serialize( const Network& network, const bool include_roundtrip = true )
+{
+  using T = typename Network::type;
+  using Infer = NetworkInference<Network, num_examples>;
+
+  require_little_endian();
+
+  std::string parameters;
+  parameters.reserve( parameter_bytes<Network>() );
+  put_parameters( parameters, network );
+
+  std::string out { magic };
+  put_integer<uint32_t>( out, version );
+  put_integer<uint32_t>( out, sizeof( T ) );
+  put_integer<uint32_t>( out, uint32_t( weight_encoding_of<typename Network::Layer0::storage_type> ) );
+  put_integer<uint32_t>( out, Network::num_layers );
+  put_integer<uint32_t>( out, include_roundtrip ? num_examples : 0 );
+  put_integer<uint32_t>( out, 0 );
+  put_integer<uint64_t>( out, Network::num_params );
+  put_integer<uint64_t>( out, checksum( parameters ) );
+
+  const size_t sizes_length = 4 * ( Network::num_layers + 1 );
+  const uint64_t parameter_offset
+    = ( header_length + sizes_length + parameter_alignment - 1 ) / parameter_alignment * parameter_alignment;
+  put_integer<uint64_t>( out, parameter_offset );
+  put_integer<uint64_t>( out, include_roundtrip ? parameter_offset + parameters.size() : 0 );
+
+  put_layer_sizes_recursive<Network>( out );
+  out.resize( parameter_offset, 0 );
+  out.append( parameters );
+
+  if ( include_roundtrip ) {
+    auto input = std::make_unique<typename Infer::Input>();
+    input->setRandom();
+
+    auto inference = std::make_unique<Infer>();
+    inference->apply( network, *input );
+
+    out.append( reinterpret_cast<const char*>( input->data() ), input->size() * sizeof( T ) );
+    out.append( reinterpret_cast<const char*>( inference->output().data() ),
+                inference->output().size() * sizeof( T ) );
+  }
+
+  return out;
+}
+
+template<class Matrix>
+void copy_matrix( Matrix& matrix, std::string_view& parameters )
+{
+  const size_t length = matrix.size() * sizeof( *matrix.data() );
+  memcpy( matrix.data(), parameters.data(), length );
+  parameters.remove_prefix( length );
+}
+
+template<NetworkT SubNetwork>
+void copy_parameters( SubNetwork& network, std::string_view parameters )
+{
+  copy_matrix( network.first.weights, parameters );
+  if constexpr ( weight_encoding_of<typename SubNetwork::Layer0::storage_type> != WeightEncoding::Plain ) {
+    copy_matrix( network.first.scales, parameters );
+  }
+  copy_matrix( network.first.biases, parameters );
+
+  if constexpr ( not SubNetwork::is_last ) {
+    copy_parameters( network.rest, parameters );
+  }
+}
+
+// Copy the parameters of a binary file into a Network (one memcpy per matrix)
+template<NetworkT Network>
+void parse( Network& network, const std::string_view file, const bool check_roundtrip = false )
+{
+  const Contents<Network> contents { file };
+  copy_parameters( network, contents.parameters );
+
+  if ( check_roundtrip ) {
+    contents.check_roundtrip( network );
+  }
+}
+
+// How a binary file's weights are stored
+inline WeightEncoding weight_encoding( const std::string_view file )
+{
+  if ( not is_binary( file ) ) {
+    throw std::runtime_error( "binary network: missing header" );
+  }
+
+  return WeightEncoding( get_integer<uint32_t>( file, 16 ) );
+}
+
+// Load a Network from either format: the binary format (checksum only) or the Serializer format.
+// Quantized weights are widened back to the Network's type.
+template<NetworkT Network>
+void load( Network& network, const std::string_view file )
+{
+  if ( is_binary( file ) ) {
+    switch ( weight_encoding( file ) ) {
+      case WeightEncoding::Int8: {
+        auto quantized = std::make_unique<typename Network::template Quantized<int8_t>>();
+        parse( *quantized, file );
+        dequantize( *quantized, network );
+        break;
+      }
+      case WeightEncoding::Float16: {
+        auto quantized = std::make_unique<typename Network::template Quantized<Eigen::half>>();
+        parse( *quantized, file );
+        dequantize( *quantized, network );
+        break;
+      }
+      default:
+        parse( network, file );
+    }
+  } else {
+    Parser parser { file };
+    parser.object( network );
+  }
+}
+
+// Load a binary file (with plain weights) of any shape: the layer sizes come from the header
+template<std::floating_point T>
+DynamicNetwork<T> load_dynamic( const std::string_view file, const bool check_roundtrip = false )
+{
+  check_preamble( file, sizeof( T ), WeightEncoding::Plain );
+
+  const uint32_t num_layers = get_integer<uint32_t>( file, 20 );
+  if ( num_layers == 0 or header_length + ( num_layers + 1 ) * sizeof( uint32_t ) > file.size() ) {
+    throw std::runtime_error( "binary network: bad number of layers" );
+  }
+
+  std::vector<size_t> sizes;
+  for ( size_t i = 0; i <= num_layers; i++ ) {
+    sizes.push_back( get_integer<uint32_t>( file, header_length + i * sizeof( uint32_t ) ) );
+  }
+
+  DynamicNetwork<T> network { sizes };
+  if ( get_integer<uint64_t>( file, 32 ) != network.num_params() ) {
+    throw std::runtime_error( "binary network: shape mismatch" );
+  }
+
+  const std::string_view parameters = parameter_block( file, network.num_params() * sizeof( T ) );
+  memcpy( network.data(), parameters.data(), parameters.size() );
+
+  if ( check_roundtrip ) {
+    using Infer = DynamicNetworkInference<T, num_examples>;
+
+    const std::string_view examples
+      = example_block( file, ( network.input_size() + network.output_size() ) * sizeof( T ) );
+    if ( examples.empty() ) {
+      throw std::runtime_error( "binary network: no roundtrip examples to check" );
+    }
+
+    /* inputs, then expected outputs, both column-major */
+    std::vector<T> example_values( examples.size() / sizeof( T ) );
+    memcpy( example_values.data(), examples.data(), examples.size() );
+    const Eigen::Map<const typename Infer::Activations> input {
+      example_values.data(), num_examples, Eigen::Index( network.input_size() ) };
+    const Eigen::Map<const typename Infer::Activations> expected_output {
+      example_values.data() + input.size(), num_examples, Eigen::Index( network.output_size() ) };
+
+    Infer inference { network };
+    inference.apply( network, input );
+
+    if ( ( inference.output() - expected_output ).cwiseAbs().maxCoeff() > 1e-5 ) {
+      throw std::runtime_error( "binary network: roundtrip failure" );
+    }
+  }
+
+  return network;
+}
+
+// A network used in place from a memory-mapped binary file: loading costs the mmap and the
+// checksum, and nothing is copied. The network is read-only (it lives in a read-only mapping).
+template<NetworkT Network>
+class MappedFile
+{
+public:
+  using Mapped = typename Network::Mapped;
+
+  explicit MappedFile( const std::string& filename, const bool check_roundtrip = false )
+    : file_( filename )
+    , contents_( file_ )
+    , view_( reinterpret_cast<typename Network::type*>( const_cast<char*>( contents_.parameters.data() ) ) )
+  {
+    if ( check_roundtrip ) {
+      contents_.check_roundtrip( view_ );
+    }
+  }
+
+  const Mapped& network() const { return view_; }
+
+private:
+  ReadOnlyFile file_;
+  Contents<Network> contents_;
+  Mapped view_;
+};
+
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <concepts>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "inference.hh"
+#include "network.hh"
+
+// A DynamicNetwork has the same structure as a Network (fully-connected layers with a leaky
+// ReLU between them), but its layer sizes are chosen at runtime, e.g. from the header of a
+// binary file (see NetworkBinary::load_dynamic). A new architecture can be loaded without
+// adding a type to dnn_types.hh or recompiling; the fixed-size Network remains the faster path
+// for models that are known in advance.
+//
+// The parameters are kept in one buffer, in FlatNetwork order (each layer's weights,
+// column-major, then its biases), and each layer is a pair of Eigen::Map views into it.
+//
+// No layer may be wider than max_dynamic_layer_size. Telling Eigen that bound at compile time
+// lets it size its matrix-product workspaces statically, so inference stays off the heap (as
+// EIGEN_NO_MALLOC requires).
+
+static constexpr int max_dynamic_layer_size = 4096;
+
+template<std::floating_point T>
+class DynamicNetwork
+{
+public:
+  using type = T;
+  using Weights = Eigen::
+    Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, max_dynamic_layer_size, max_dynamic_layer_size>;
+  using Biases = Eigen::Matrix<T, 1, Eigen::Dynamic, Eigen::RowMajor, 1, max_dynamic_layer_size>;
+
+  struct Layer
+  {
+    Eigen::Map<Weights> weights;
+    Eigen::Map<Biases> biases;
+
+    size_t input_size() const { return weights.rows(); }
+    size_t output_size() const { return weights.cols(); }
+  };
+
+  // A network with the given sizes (the input size, then each layer's output size), all zero
+  explicit DynamicNetwork( const std::vector<size_t>& sizes )
+    : sizes_( sizes )
+  {
+    if ( sizes_.size() < 2 ) {
+      throw std::runtime_error( "dynamic network: no layers" );
+    }
+
+    for ( const size_t size : sizes_ ) {
+      if ( size == 0 or size > max_dynamic_layer_size ) {
+        throw std::runtime_error( "dynamic network: unsupported layer size " + std::to_string( size ) );
+      }
+    }
+
+    size_t num_params = 0;
+    for ( size_t i = 0; i + 1 < sizes_.size(); i++ ) {
+      num_params += ( sizes_[i] + 1 ) * sizes_[i + 1];
+    }
+    parameters_.resize( num_params );
+
+    T* parameters = parameters_.data();
+    for ( size_t i = 0; i + 1 < sizes_.size(); i++ ) {
+      const size_t input_size = sizes_[i], output_size = sizes_[i + 1];
+      layers_.push_back( { Eigen::Map<Weights>( parameters, input_size, output_size ),
+                           Eigen::Map<Biases>( parameters + input_size * output_size, 1, output_size ) } );
+      parameters += ( input_size + 1 ) * output_size;
+    }
+  }
+
+  // A copy of a Network (or MappedNetwork)
+  template<NetworkT Network>
+  requires std::same_as<typename Network::type, T>
+  explicit DynamicNetwork( const Network& network )
+    : DynamicNetwork( layer_sizes<Network>() )
+  {
+    copy_from( network, 0 );
+  }
+
+  // The views point into parameters_, so a DynamicNetwork can be moved but not copied
+  DynamicNetwork( DynamicNetwork&& other ) = default;
+  DynamicNetwork& operator=( DynamicNetwork&& other ) = default;
+  DynamicNetwork( const DynamicNetwork& other ) = delete;
+  DynamicNetwork& operator=( const DynamicNetwork& other ) = delete;
+
+  const std::vector<size_t>& sizes() const { return sizes_; }
+  size_t num_layers() const { return layers_.size(); }
+  size_t num_params() const { return parameters_.size(); }
+  size_t input_size() const { return sizes_.front(); }
+  size_t output_size() const { return sizes_.back(); }
+
+  Layer& layer( const size_t i ) { return layers_.at( i ); }
+  const Layer& layer( const size_t i ) const { return layers_.at( i ); }
+
+  T* data() { return parameters_.data(); }
+  const T* data() const { return parameters_.data(); }
+
+  bool operator==( const DynamicNetwork& other ) const
+  {
+    return sizes_ == other.sizes_ and parameters_ == other.parameters_;
+  }
+
+  // The sizes of a Network type, in the same form
+  template<NetworkT Network>
+  static std::vector<size_t> layer_sizes()
+  {
+    std::vector<size_t> ret { Network::input_size };
+    append_output_sizes<Network>( ret );
+    return ret;
+  }
+
+private:
+  std::vector<size_t> sizes_ {};
+  std::vector<T> parameters_ {};
+  std::vector<Layer> layers_ {};
+
+  template<NetworkT SubNetwork>
+  static void append_output_sizes( std::vector<size_t>& sizes )
+  {
+    sizes.push_back( SubNetwork::Layer0::output_size );
+
+    if constexpr ( not SubNetwork::is_last ) {
+      append_output_sizes<typename SubNetwork::Rest>( sizes );
+    }
+  }
+
+  template<NetworkT SubNetwork>
+  void copy_from( const SubNetwork& network, const size_t i )
+  {
+    layers_[i].weights = network.first.weights;
+    layers_[i].biases = network.first.biases;
+
+    if constexpr ( not SubNetwork::is_last ) {
+      copy_from( network.rest, i + 1 );
+    }
+  }
+};
+
+// Inference for a DynamicNetwork, with the same tiled matrix multiplication and fused epilogue
+// (finish_tile) as NetworkInference. The activations are allocated once, for one shape of
+// network; apply() checks that the network it is given has that shape.
+template<std::floating_point T, int batch_size>
+class DynamicNetworkInference
+{
+  static_assert( batch_size > 0 );
+
+  // Eigen requires a single-row matrix to be row-major
+  static constexpr int options = batch_size == 1 ? Eigen::RowMajor : Eigen::ColMajor;
+
+  // Output columns per tile (as in LayerInference)
+  static constexpr int tile_width = 64;
+
+  using TileWeights = Eigen::Map<
+    const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor, max_dynamic_layer_size, tile_width>>;
+  using TileBiases = Eigen::Map<const Eigen::Matrix<T, 1, Eigen::Dynamic, Eigen::RowMajor, 1, tile_width>>;
+  using TileOutput = Eigen::Map<Eigen::Matrix<T, batch_size, Eigen::Dynamic, options, batch_size, tile_width>>;
+
+public:
+  // One layer's activations: a row per example, a column per output
+  using Activations = Eigen::Matrix<T, batch_size, Eigen::Dynamic, options, batch_size, max_dynamic_layer_size>;
+
+  explicit DynamicNetworkInference( const DynamicNetwork<T>& network )
+    : sizes_( network.sizes() )
+  {
+    size_t total = 0;
+    for ( size_t i = 1; i < sizes_.size(); i++ ) {
+      offsets_.push_back( total );
+      total += batch_size * sizes_[i];
+    }
+    activations_.resize( total );
+  }
+
+  // Apply the network to a batch_size x input_size matrix
+  template<class Input>
+  void apply( const DynamicNetwork<T>& network, const Eigen::MatrixBase<Input>& input )
+  {
+    if ( network.sizes() != sizes_ ) {
+      throw std::runtime_error( "dynamic network inference: network shape mismatch" );
+    }
+
+    if ( input.rows() != batch_size or size_t( input.cols() ) != network.input_size() ) {
+      throw std::runtime_error( "dynamic network inference: input size mismatch" );
+    }
+
+    const size_t last = network.num_layers() - 1;
+    for ( size_t i = 0; i <= last; i++ ) {
+      if ( i == 0 ) {
+        apply_layer( network.layer( i ), input.derived(), i == last, activations( i ) );
+      } else {
+        const Eigen::Map<const Activations> previous { activations( i - 1 ), batch_size, Eigen::Index( sizes_[i] ) };
+        apply_layer( network.layer( i ), previous, i == last, activations( i ) );
+      }
+    }
+  }
+
+  // Activations (outputs) from the last layer
+  Eigen::Map<const Activations> output() const
+  {
+    return { activations( sizes_.size() - 2 ), batch_size, Eigen::Index( sizes_.back() ) };
+  }
+
+private:
+  std::vector<size_t> sizes_;
+  std::vector<size_t> offsets_ {};
+  std::vector<T> activations_ {};
+
+  T* activations( const size_t layer ) { return activations_.data() + offsets_[layer]; }
+  const T* activations( const size_t layer ) const { return activations_.data() + offsets_[layer]; }
+
+  // Each tile of output columns is contiguous in the weights, biases and output
+  template<class Input>
+  static void apply_layer( const typename DynamicNetwork<T>::Layer& layer,
+                           const Input& input,
+                           const bool is_last,
+                           T* output )
+  {
+    const Eigen::Index input_size = layer.weights.rows(), output_size = layer.weights.cols();
+
+    for ( Eigen::Index column = 0; column < output_size; column += tile_width ) {
+      const Eigen::Index width = std::min( Eigen::Index( tile_width ), output_size - column );
+
+      TileOutput tile { output + column * batch_size, batch_size, width };
+      tile.noalias() = input * TileWeights { layer.weights.data() + column * input_size, input_size, width };
+
+      const TileBiases biases { layer.biases.data() + column, 1, width };
+      if ( is_last ) {
+        finish_tile<false>( tile, biases );
+      } else {
+        finish_tile<true>( tile, biases );
+      }
+    }
+  }
+};
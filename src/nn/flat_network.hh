@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+
+#include "network.hh"
+
+// A FlatNetwork keeps all of a Network's parameters in one aligned buffer, in serialization
+// order (each layer's weights, column-major, then its biases). network() is a MappedNetwork
+// of Eigen::Map views into the buffer, usable anywhere a Network is (inference, backprop,
+// gradient descent). Snapshots are a single memcpy, and parameters() lets an update touch
+// every parameter in one pass.
+
+template<NetworkT Network>
+class FlatNetwork
+{
+public:
+  using type = typename Network::type;
+  using Mapped = typename Network::Mapped;
+  using Parameters = Eigen::Map<Eigen::Matrix<type, Eigen::Dynamic, 1>, Eigen::Aligned64>;
+  using ConstParameters = Eigen::Map<const Eigen::Matrix<type, Eigen::Dynamic, 1>, Eigen::Aligned64>;
+
+  static constexpr size_t num_params = Network::num_params;
+  static constexpr size_t alignment = 64;
+
+  FlatNetwork() { std::fill( data(), data() + num_params, type {} ); }
+
+  explicit FlatNetwork( const Network& network ) { load( network ); }
+
+  FlatNetwork( const FlatNetwork& other ) { *this = other; }
+
+  FlatNetwork& operator=( const FlatNetwork& other )
+  {
+    std::memcpy( data(), other.data(), size_bytes() );
+    return *this;
+  }
+
+  // The network, as views into the buffer
+  Mapped& network() { return view_; }
+  const Mapped& network() const { return view_; }
+
+  // Every parameter as one vector
+  Parameters parameters() { return Parameters( data(), num_params ); }
+  ConstParameters parameters() const { return ConstParameters( data(), num_params ); }
+
+  type* data() { return buffer_.get(); }
+  const type* data() const { return buffer_.get(); }
+
+  static constexpr size_t size_bytes() { return num_params * sizeof( type ); }
+
+  // The raw parameters (native byte order)
+  std::string_view bytes() const { return { reinterpret_cast<const char*>( data() ), size_bytes() }; }
+
+  // Copy the parameters in from, or out to, an ordinary Network
+  void load( const Network& network ) { copy<Network>( network, view_ ); }
+  void store( Network& network ) const { copy<Network>( view_, network ); }
+
+  bool operator==( const FlatNetwork& other ) const
+  {
+    return std::equal( data(), data() + num_params, other.data() );
+  }
+
+private:
+  struct AlignedDelete
+  {
+    void operator()( type* buffer ) const { ::operator delete[]( buffer, std::align_val_t { alignment } ); }
+  };
+
+  std::unique_ptr<type[], AlignedDelete> buffer_ {
+    static_cast<type*>( ::operator new[]( size_bytes(), std::align_val_t { alignment } ) )
+  };
+  Mapped view_ { buffer_.get() };
+
+  template<NetworkT SubNetwork, class Source, class Dest>
+  static void copy( const Source& source, Dest& dest )
+  {
+    dest.first.weights = source.first.weights;
+    dest.first.biases = source.first.biases;
+
+    if constexpr ( not SubNetwork::is_last ) {
+      copy<typename SubNetwork::Rest>( source.rest, dest.rest );
+    }
+  }
+};
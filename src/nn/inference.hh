@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Eigen/Dense>
+#include <algorithm>
 #include <concepts>
 #include <type_traits>
 
@@ -12,6 +13,31 @@
 
 static constexpr float leaky_constant = 0.01;
 
+// How a layer's biases and activation are applied after the matrix multiplication
+enum class Epilogue
+{
+  TwoPass, // add the biases to the whole output, then make a second pass for the activation
+  Fused    // finish each tile of output columns (biases + activation) right after computing it
+};
+
+// The epilogue a Network uses unless its NetworkInference asks for another one.
+// Specialize this for a Network type to change its default.
+template<class Network>
+inline constexpr Epilogue default_epilogue = Epilogue::Fused;
+
+// Finish one tile of a layer's output columns: add the biases, then the leaky ReLU if `activate`
+template<bool activate, class Tile, class Biases>
+static void finish_tile( Tile& tile, const Biases& biases )
+{
+  using T = typename Tile::Scalar;
+
+  tile.rowwise() += biases;
+  if constexpr ( activate ) {
+    /* branch-free leaky ReLU (leaky_constant < 1) */
+    tile.array() = tile.array().max( tile.array() * T( leaky_constant ) );
+  }
+}
+
 template<LayerT Layer, int batch_size>
 struct LayerInference
 {
@@ -26,8 +52,100 @@ struct LayerInference
     output = ( input * layer.weights ).rowwise() + layer.biases; // unactivated
   }
 
+  // The same, plus the leaky ReLU if `activate`, one tile of output columns at a time
+  // so that the biases and activation are applied while the tile is still in cache
+  template<bool activate>
+  void apply_fully_connected_layer_fused( const Layer& layer, const Input& input )
+  {
+    static_assert( batch_size > 0 );
+
+    constexpr int full_tiles = Layer::output_size / tile_width;
+    constexpr int remainder = Layer::output_size % tile_width;
+
+    for ( int tile = 0; tile < full_tiles; tile++ ) {
+      apply_tile<tile_width, activate>( layer, input, tile * tile_width );
+    }
+
+    if constexpr ( remainder > 0 ) {
+      apply_tile<remainder, activate>( layer, input, full_tiles * tile_width );
+    }
+  }
+
+  // Activations (outputs) from the layer
+  Output output {};
+
+private:
+  // Output columns per tile of the fused path
+  static constexpr int tile_width = 64;
+
+  template<int width, bool activate>
+  void apply_tile( const Layer& layer, const Input& input, const int column )
+  {
+    auto tile = output.template middleCols<width>( column );
+    tile.noalias() = input * layer.weights.template middleCols<width>( column );
+
+    finish_tile<activate>( tile, layer.biases.template middleCols<width>( column ) );
+  }
+};
+
+// Inference for a layer with reduced-precision weights. Each tile of weights is widened to T
+// in a small workspace (which stays in cache) and multiplied; the per-output scales are then
+// applied along with the biases.
+template<std::floating_point T, QuantizedStorageT Storage, int input_size, int output_size, int batch_size>
+struct LayerInference<QuantizedLayer<T, Storage, input_size, output_size>, batch_size>
+{
+  using Layer = QuantizedLayer<T, Storage, input_size, output_size>;
+
+  // Types of the input and output matrices
+  using Input = Eigen::Matrix<T, batch_size, input_size>;
+  using Output = Eigen::Matrix<T, batch_size, output_size>;
+
+  // Apply the linear part of a fully-connected layer (matrix multiplication)
+  void apply_fully_connected_layer( const Layer& layer, const Input& input )
+  {
+    apply_fully_connected_layer_fused<false>( layer, input );
+  }
+
+  // The same, plus the leaky ReLU if `activate`
+  template<bool activate>
+  void apply_fully_connected_layer_fused( const Layer& layer, const Input& input )
+  {
+    static_assert( batch_size > 0 );
+
+    constexpr int full_tiles = output_size / tile_width;
+    constexpr int remainder = output_size % tile_width;
+
+    for ( int tile = 0; tile < full_tiles; tile++ ) {
+      apply_tile<tile_width, activate>( layer, input, tile * tile_width );
+    }
+
+    if constexpr ( remainder > 0 ) {
+      apply_tile<remainder, activate>( layer, input, full_tiles * tile_width );
+    }
+  }
+
   // Activations (outputs) from the layer
   Output output {};
+
+private:
+  // Output columns per tile
+  static constexpr int tile_width = 64;
+
+  // One tile of weights, widened to T
+  Eigen::Matrix<T, input_size, std::min( tile_width, output_size )> widened_ {};
+
+  template<int width, bool activate>
+  void apply_tile( const Layer& layer, const Input& input, const int column )
+  {
+    auto widened = widened_.template leftCols<width>();
+    widened = layer.weights.template middleCols<width>( column ).template cast<T>();
+
+    auto tile = output.template middleCols<width>( column );
+    tile.noalias() = input * widened;
+
+    tile.array().rowwise() *= layer.scales.template middleCols<width>( column ).array();
+    finish_tile<activate>( tile, layer.biases.template middleCols<width>( column ) );
+  }
 };
 
 // Apply the nonlinear part of the layer ("leaky ReLU")
@@ -37,15 +155,15 @@ static void apply_leaky_relu( MatrixT& output )
   output.noalias() = output.unaryExpr( []( const auto val ) { return val > 0 ? val : leaky_constant * val; } );
 }
 
-template<NetworkT Network, int batch_size, bool is_last_T>
+template<NetworkT Network, int batch_size, bool is_last_T, Epilogue epilogue>
 struct NetworkInferenceHelper;
 
-template<NetworkT Network, int batch_size>
-using NetworkInference = NetworkInferenceHelper<Network, batch_size, Network::is_last>;
+template<NetworkT Network, int batch_size, Epilogue epilogue = default_epilogue<Network>>
+using NetworkInference = NetworkInferenceHelper<Network, batch_size, Network::is_last, epilogue>;
 
 // Here is the recursive case: inference for a non-terminal Network.
-template<NetworkT Network, int batch_size>
-struct NetworkInferenceHelper<Network, batch_size, false>
+template<NetworkT Network, int batch_size, Epilogue epilogue>
+struct NetworkInferenceHelper<Network, batch_size, false, epilogue>
 {
   static_assert( not Network::is_last );
 
@@ -53,7 +171,7 @@ struct NetworkInferenceHelper<Network, batch_size, false>
   static constexpr bool is_last = false;
 
   using LayerInfer = LayerInference<typename Network::Layer0, batch_size>;
-  using RestInfer = NetworkInference<typename Network::Rest, batch_size>;
+  using RestInfer = NetworkInference<typename Network::Rest, batch_size, epilogue>;
 
   // Types of the input and output matrices
   using Input = typename LayerInfer::Input;
@@ -72,15 +190,19 @@ struct NetworkInferenceHelper<Network, batch_size, false>
   // This applies the current layer and then recurses to the rest.
   void apply( const Network& network, const Input& input )
   {
-    first.apply_fully_connected_layer( network.first, input );
-    apply_leaky_relu( first.output );
+    if constexpr ( epilogue == Epilogue::Fused ) {
+      first.template apply_fully_connected_layer_fused<true>( network.first, input );
+    } else {
+      first.apply_fully_connected_layer( network.first, input );
+      apply_leaky_relu( first.output );
+    }
     rest.apply( network.rest, first.output );
   }
 };
 
 // Here is the base case: inference for a single-layer Network.
-template<NetworkT Network, int batch_size>
-struct NetworkInferenceHelper<Network, batch_size, true>
+template<NetworkT Network, int batch_size, Epilogue epilogue>
+struct NetworkInferenceHelper<Network, batch_size, true, epilogue>
 {
   static_assert( Network::is_last );
 
@@ -104,7 +226,11 @@ struct NetworkInferenceHelper<Network, batch_size, true>
   // This applies the current (last) layer only, with no activation function.
   void apply( const Network& network, const Input& input )
   {
-    first.apply_fully_connected_layer( network.first, input );
+    if constexpr ( epilogue == Epilogue::Fused ) {
+      first.template apply_fully_connected_layer_fused<false>( network.first, input );
+    } else {
+      first.apply_fully_connected_layer( network.first, input );
+    }
   }
 };
 
@@ -117,5 +243,5 @@ concept LayerInferenceT = requires( ProposedLayerInference c )
 template<class ProposedNetworkInference>
 concept NetworkInferenceT = requires( ProposedNetworkInference c )
 {
-  []<NetworkT Network, int batch_size>( NetworkInference<Network, batch_size>& ) {}( c );
+  []<NetworkT Network, int batch_size, Epilogue epilogue>( NetworkInference<Network, batch_size, epilogue>& ) {}( c );
 };
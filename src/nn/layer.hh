@@ -2,6 +2,7 @@
 
 #include <Eigen/Dense>
 #include <concepts>
+#include <cstdint>
 
 // The Layer models a neural-network layer that transforms a vector
 // of size "input_size" into a vector of size "output_size".
@@ -19,6 +20,7 @@ struct Layer
 
   // The type of entry (e.g. float or double) and of the weight and bias matrices
   using type = T;
+  using storage_type = T;
   using Weights = Eigen::Matrix<T, input_size, output_size>;
   using Biases = Eigen::Matrix<T, 1, output_size>;
 
@@ -30,8 +32,75 @@ struct Layer
   bool operator==( const Layer& other ) const = default;
 };
 
+// A MappedLayer has the same shape, but its weights and biases live in a parameter buffer
+// owned by someone else (see "flat_network.hh"): the weights (column-major), then the biases.
+template<std::floating_point T, int input_size_T, int output_size_T>
+struct MappedLayer
+{
+  // Helpful constants
+  static constexpr size_t input_size = input_size_T, output_size = output_size_T;
+  static constexpr size_t num_params = ( input_size + 1 ) * output_size;
+
+  // The type of entry and of the weight and bias matrices (the same as the Layer's)
+  using type = T;
+  using storage_type = T;
+  using Weights = typename Layer<T, input_size_T, output_size_T>::Weights;
+  using Biases = typename Layer<T, input_size_T, output_size_T>::Biases;
+
+  // Views of the weights and biases
+  Eigen::Map<Weights> weights;
+  Eigen::Map<Biases> biases;
+
+  explicit MappedLayer( T* parameters )
+    : weights( parameters )
+    , biases( parameters + input_size * output_size )
+  {}
+
+  // A view can't be copied (that would alias the buffer); copy the buffer instead
+  MappedLayer( const MappedLayer& ) = delete;
+  MappedLayer& operator=( const MappedLayer& ) = delete;
+};
+
+// The types a QuantizedLayer can store its weights in
+template<class Storage>
+concept QuantizedStorageT = std::same_as<Storage, int8_t> or std::same_as<Storage, Eigen::half>;
+
+// A QuantizedLayer has the same shape, but stores its weights at reduced precision (see
+// "quantize.hh"): as int8_t with one scale per output (each weight is its output's scale times
+// the stored value), or as Eigen::half (with every scale 1). Biases and arithmetic stay in T.
+template<std::floating_point T, QuantizedStorageT Storage, int input_size_T, int output_size_T>
+struct QuantizedLayer
+{
+  // Helpful constants
+  static constexpr size_t input_size = input_size_T, output_size = output_size_T;
+  static constexpr size_t num_params = ( input_size + 1 ) * output_size;
+
+  // The type of entry, the type the weights are stored in, and the matrices
+  using type = T;
+  using storage_type = Storage;
+  using Weights = Eigen::Matrix<Storage, input_size, output_size>;
+  using Scales = Eigen::Matrix<T, 1, output_size>;
+  using Biases = Eigen::Matrix<T, 1, output_size>;
+
+  // What the layer contains: quantized weights, their scales, and biases.
+  Weights weights {};
+  Scales scales {};
+  Biases biases {};
+
+  // Comparison
+  bool operator==( const QuantizedLayer& other ) const = default;
+};
+
 template<class ProposedLayer>
 concept LayerT = requires( ProposedLayer c )
 {
   []<typename T, int in, int out>( Layer<T, in, out>& ) {}( c );
+}
+or requires( ProposedLayer c )
+{
+  []<typename T, int in, int out>( MappedLayer<T, in, out>& ) {}( c );
+}
+or requires( ProposedLayer c )
+{
+  []<typename T, typename Storage, int in, int out>( QuantizedLayer<T, Storage, in, out>& ) {}( c );
 };
@@ -10,6 +10,12 @@
 // one layer (layer0), and then either (a) the "rest" of the Network (recursive case)
 // or (b) nothing else (the base case).
 
+template<std::floating_point T, int i0, int o0, int... o_rest>
+struct MappedNetwork;
+
+template<std::floating_point T, QuantizedStorageT Storage, int i0, int o0, int... o_rest>
+struct QuantizedNetwork;
+
 // Here is the recursive case. "i0" is the first layer's input size,
 // and "o0" is its output size (also the input size of the next layer).
 // The rest of the input/output sizes come afterward; each layer's output size
@@ -33,6 +39,13 @@ struct Network
   static constexpr size_t output_size = Rest::output_size;
   static constexpr bool is_last = false;
 
+  // The same network with its parameters in an external buffer
+  using Mapped = MappedNetwork<T, i0, o0, o_rest...>;
+
+  // The same network with its weights stored at reduced precision
+  template<QuantizedStorageT Storage>
+  using Quantized = QuantizedNetwork<T, Storage, i0, o0, o_rest...>;
+
   // Comparison
   bool operator==( const Network& other ) const = default;
 };
@@ -56,12 +69,109 @@ struct Network<T, i0, o0>
   static constexpr size_t output_size = Layer0::output_size;
   static constexpr bool is_last = true;
 
+  // The same network with its parameters in an external buffer
+  using Mapped = MappedNetwork<T, i0, o0>;
+
+  // The same network with its weights stored at reduced precision
+  template<QuantizedStorageT Storage>
+  using Quantized = QuantizedNetwork<T, Storage, i0, o0>;
+
   // Comparison
   bool operator==( const Network& other ) const = default;
 };
 
+// The MappedNetwork mirrors the Network, but each layer is a MappedLayer viewing one
+// contiguous buffer of num_params entries: layer 0's weights and biases, then layer 1's, etc.
+// (the same order the serializer writes them in).
+template<std::floating_point T, int i0, int o0, int... o_rest>
+struct MappedNetwork
+{
+  using type = T;
+  using Layer0 = MappedLayer<T, i0, o0>;
+  using Rest = MappedNetwork<T, o0, o_rest...>;
+
+  Layer0 first;
+  Rest rest;
+
+  static constexpr size_t num_layers = Rest::num_layers + 1;
+  static constexpr size_t num_params = Layer0::num_params + Rest::num_params;
+  static constexpr size_t input_size = Layer0::input_size;
+  static constexpr size_t output_size = Rest::output_size;
+  static constexpr bool is_last = false;
+
+  explicit MappedNetwork( T* parameters )
+    : first( parameters )
+    , rest( parameters + Layer0::num_params )
+  {}
+};
+
+template<std::floating_point T, int i0, int o0>
+struct MappedNetwork<T, i0, o0>
+{
+  using type = T;
+  using Layer0 = MappedLayer<T, i0, o0>;
+
+  Layer0 first;
+
+  static constexpr size_t num_layers = 1;
+  static constexpr size_t num_params = Layer0::num_params;
+  static constexpr size_t input_size = Layer0::input_size;
+  static constexpr size_t output_size = Layer0::output_size;
+  static constexpr bool is_last = true;
+
+  explicit MappedNetwork( T* parameters )
+    : first( parameters )
+  {}
+};
+
+// The QuantizedNetwork mirrors the Network, with each layer a QuantizedLayer (for inference only).
+template<std::floating_point T, QuantizedStorageT Storage, int i0, int o0, int... o_rest>
+struct QuantizedNetwork
+{
+  using type = T;
+  using Layer0 = QuantizedLayer<T, Storage, i0, o0>;
+  using Rest = QuantizedNetwork<T, Storage, o0, o_rest...>;
+
+  Layer0 first {};
+  Rest rest {};
+
+  static constexpr size_t num_layers = Rest::num_layers + 1;
+  static constexpr size_t num_params = Layer0::num_params + Rest::num_params;
+  static constexpr size_t input_size = Layer0::input_size;
+  static constexpr size_t output_size = Rest::output_size;
+  static constexpr bool is_last = false;
+
+  bool operator==( const QuantizedNetwork& other ) const = default;
+};
+
+template<std::floating_point T, QuantizedStorageT Storage, int i0, int o0>
+struct QuantizedNetwork<T, Storage, i0, o0>
+{
+  using type = T;
+  using Layer0 = QuantizedLayer<T, Storage, i0, o0>;
+
+  Layer0 first {};
+
+  static constexpr size_t num_layers = 1;
+  static constexpr size_t num_params = Layer0::num_params;
+  static constexpr size_t input_size = Layer0::input_size;
+  static constexpr size_t output_size = Layer0::output_size;
+  static constexpr bool is_last = true;
+
+  bool operator==( const QuantizedNetwork& other ) const = default;
+};
+
 template<class ProposedNetwork>
 concept NetworkT = requires( ProposedNetwork c )
 {
   []<typename T, int i0, int o0, int... o_rest>( Network<T, i0, o0, o_rest...>& ) {}( c );
+}
+or requires( ProposedNetwork c )
+{
+  []<typename T, int i0, int o0, int... o_rest>( MappedNetwork<T, i0, o0, o_rest...>& ) {}( c );
+}
+or requires( ProposedNetwork c )
+{
+  []<typename T, typename Storage, int i0, int o0, int... o_rest>( QuantizedNetwork<T, Storage, i0, o0, o_rest...>& ) {
+  }( c );
 };
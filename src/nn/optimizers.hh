@@ -0,0 +1,159 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <concepts>
+#include <type_traits>
+
+#include "backprop.hh"
+#include "gradient_descent.hh"
+
+// Optimizers that keep state between steps, as alternatives to plain gradient descent.
+// Each keeps its state in weight- and bias-shaped matrices alongside the layer and plugs
+// into NetworkTraining in place of NetworkGradientDescent, e.g.
+// NetworkTraining<Network, batch_size, NetworkAdam>.
+
+static constexpr float momentum_constant = 0.9;  // fraction of the previous step carried forward
+static constexpr float rmsprop_decay = 0.9;      // decay of the mean squared gradient
+static constexpr float adam_beta1 = 0.9;         // decay of Adam's first moment
+static constexpr float adam_beta2 = 0.999;       // decay of Adam's second moment
+static constexpr float optimizer_epsilon = 1e-8; // keeps the adaptive step sizes finite
+
+// Gradient descent with (heavy-ball) momentum
+template<LayerT Layer, int batch_size>
+struct LayerMomentum
+{
+  using Backprop = LayerBackPropagation<Layer, batch_size>;
+
+  typename Layer::Weights weight_velocity { Layer::Weights::Zero() };
+  typename Layer::Biases bias_velocity { Layer::Biases::Zero() };
+
+  void update( Layer& layer, const Backprop& backprop, float learning_rate )
+  {
+    weight_velocity = momentum_constant * weight_velocity + backprop.weight_gradient;
+    bias_velocity = momentum_constant * bias_velocity + backprop.bias_gradient;
+
+    layer.weights.noalias() -= learning_rate * weight_velocity;
+    layer.biases.noalias() -= learning_rate * bias_velocity;
+  }
+};
+
+// Gradient descent scaled by a running root-mean-square of the gradient
+template<LayerT Layer, int batch_size>
+struct LayerRMSProp
+{
+  using Backprop = LayerBackPropagation<Layer, batch_size>;
+
+  typename Layer::Weights weight_mean_square { Layer::Weights::Zero() };
+  typename Layer::Biases bias_mean_square { Layer::Biases::Zero() };
+
+  void update( Layer& layer, const Backprop& backprop, float learning_rate )
+  {
+    step( layer.weights, weight_mean_square, backprop.weight_gradient, learning_rate );
+    step( layer.biases, bias_mean_square, backprop.bias_gradient, learning_rate );
+  }
+
+private:
+  template<class Parameters, class Matrix>
+  static void step( Parameters& parameters, Matrix& mean_square, const Matrix& gradient, float learning_rate )
+  {
+    mean_square.array() = rmsprop_decay * mean_square.array() + ( 1 - rmsprop_decay ) * gradient.array().square();
+    parameters.array() -= learning_rate * gradient.array() / ( mean_square.array().sqrt() + optimizer_epsilon );
+  }
+};
+
+// Adam: momentum on the gradient, scaled by the running RMS, with bias correction
+template<LayerT Layer, int batch_size>
+struct LayerAdam
+{
+  using Backprop = LayerBackPropagation<Layer, batch_size>;
+
+  typename Layer::Weights weight_mean { Layer::Weights::Zero() };
+  typename Layer::Weights weight_mean_square { Layer::Weights::Zero() };
+  typename Layer::Biases bias_mean { Layer::Biases::Zero() };
+  typename Layer::Biases bias_mean_square { Layer::Biases::Zero() };
+  unsigned int steps {};
+
+  void update( Layer& layer, const Backprop& backprop, float learning_rate )
+  {
+    steps++;
+
+    /* fold the bias corrections into the step size */
+    const float corrected_learning_rate
+      = learning_rate * std::sqrt( 1 - std::pow( adam_beta2, steps ) ) / ( 1 - std::pow( adam_beta1, steps ) );
+
+    step( layer.weights, weight_mean, weight_mean_square, backprop.weight_gradient, corrected_learning_rate );
+    step( layer.biases, bias_mean, bias_mean_square, backprop.bias_gradient, corrected_learning_rate );
+  }
+
+private:
+  template<class Parameters, class Matrix>
+  static void step( Parameters& parameters,
+                    Matrix& mean,
+                    Matrix& mean_square,
+                    const Matrix& gradient,
+                    float learning_rate )
+  {
+    mean.array() = adam_beta1 * mean.array() + ( 1 - adam_beta1 ) * gradient.array();
+    mean_square.array() = adam_beta2 * mean_square.array() + ( 1 - adam_beta2 ) * gradient.array().square();
+    parameters.array() -= learning_rate * mean.array() / ( mean_square.array().sqrt() + optimizer_epsilon );
+  }
+};
+
+template<template<class, int> class LayerOptimizer, NetworkT Network, int batch_size, bool is_last_T>
+struct NetworkOptimizerHelper;
+
+template<NetworkT Network, int batch_size>
+using NetworkMomentum = NetworkOptimizerHelper<LayerMomentum, Network, batch_size, Network::is_last>;
+
+template<NetworkT Network, int batch_size>
+using NetworkRMSProp = NetworkOptimizerHelper<LayerRMSProp, Network, batch_size, Network::is_last>;
+
+template<NetworkT Network, int batch_size>
+using NetworkAdam = NetworkOptimizerHelper<LayerAdam, Network, batch_size, Network::is_last>;
+
+// Here is the recursive case: optimization for a non-terminal Network.
+template<template<class, int> class LayerOptimizer, NetworkT Network, int batch_size>
+struct NetworkOptimizerHelper<LayerOptimizer, Network, batch_size, false>
+{
+  static_assert( not Network::is_last );
+
+  // Helpful boolean to indicate if this is the last layer
+  static constexpr bool is_last = false;
+
+  using NetworkBackProp = NetworkBackPropagation<Network, batch_size>;
+  using LayerOptimize = LayerOptimizer<typename Network::Layer0, batch_size>;
+  using RestOptimize
+    = NetworkOptimizerHelper<LayerOptimizer, typename Network::Rest, batch_size, Network::Rest::is_last>;
+
+  // Optimizer state
+  LayerOptimize first {};
+  RestOptimize rest {};
+
+  void update( Network& network, const NetworkBackProp& backprop, float learning_rate )
+  {
+    first.update( network.first, backprop.first, learning_rate );
+    rest.update( network.rest, backprop.rest, learning_rate );
+  }
+};
+
+// Here is the base case: optimization for a single-layer Network.
+template<template<class, int> class LayerOptimizer, NetworkT Network, int batch_size>
+struct NetworkOptimizerHelper<LayerOptimizer, Network, batch_size, true>
+{
+  static_assert( Network::is_last );
+
+  // Helpful boolean to indicate if this is the last layer
+  static constexpr bool is_last = true;
+
+  using NetworkBackProp = NetworkBackPropagation<Network, batch_size>;
+  using LayerOptimize = LayerOptimizer<typename Network::Layer0, batch_size>;
+
+  // Optimizer state
+  LayerOptimize first {};
+
+  void update( Network& network, const NetworkBackProp& backprop, float learning_rate )
+  {
+    first.update( network.first, backprop.first, learning_rate );
+  }
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <barrier>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "backprop.hh"
+#include "gradient_descent.hh"
+#include "inference.hh"
+#include "network.hh"
+
+// Data-parallel training: a large batch is split into shards of `shard_size` rows, and
+// the shards are shared out among worker threads. Each worker has its own inference and
+// backpropagation workspace and sums the gradients of its shards. The workers then
+// reduce those sums (each worker taking a slice of every layer's parameters), and a
+// single gradient-descent step is applied -- the same step NetworkTraining would take
+// on the whole batch at once.
+
+// Add one backpropagation's gradients into another, restricted to the worker's slice of each layer
+template<LayerT Layer, int batch_size>
+static void accumulate_layer_gradients( LayerBackPropagation<Layer, batch_size>& sum,
+                                        const LayerBackPropagation<Layer, batch_size>& addend,
+                                        const size_t worker,
+                                        const size_t num_workers )
+{
+  auto accumulate = [&]( auto& sum_matrix, const auto& addend_matrix ) {
+    const size_t size = sum_matrix.size();
+    const size_t begin = size * worker / num_workers;
+    const size_t end = size * ( worker + 1 ) / num_workers;
+    for ( size_t i = begin; i < end; ++i ) {
+      *( sum_matrix.data() + i ) += *( addend_matrix.data() + i );
+    }
+  };
+
+  accumulate( sum.weight_gradient, addend.weight_gradient );
+  accumulate( sum.bias_gradient, addend.bias_gradient );
+}
+
+template<NetworkT Network, int batch_size>
+static void accumulate_gradients( NetworkBackPropagation<Network, batch_size>& sum,
+                                  const NetworkBackPropagation<Network, batch_size>& addend,
+                                  const size_t worker = 0,
+                                  const size_t num_workers = 1 )
+{
+  accumulate_layer_gradients( sum.first, addend.first, worker, num_workers );
+
+  if constexpr ( not Network::is_last ) {
+    accumulate_gradients<typename Network::Rest, batch_size>( sum.rest, addend.rest, worker, num_workers );
+  }
+}
+
+template<NetworkT Network, int shard_size>
+class ParallelNetworkTraining
+{
+public:
+  using Infer = NetworkInference<Network, shard_size>;
+  using BackProp = NetworkBackPropagation<Network, shard_size>;
+  using GradientDescent = NetworkGradientDescent<Network, shard_size>;
+
+  using Input = typename Infer::Input;
+  using Output = typename Infer::Output;
+  using PdLossWrtOutputs = typename Infer::Output;
+
+  // The loss derivative for one shard's predictions; the second argument is the shard's index
+  using PdLossFunction = std::function<PdLossWrtOutputs( const Output&, size_t )>;
+
+  // `num_threads` includes the thread that calls train()
+  explicit ParallelNetworkTraining( const size_t num_threads = std::max( 1U, std::thread::hardware_concurrency() ) )
+    : workers_( num_threads )
+    , start_( num_threads )
+    , computed_( num_threads )
+    , done_( num_threads )
+  {
+    for ( auto& worker : workers_ ) {
+      worker = std::make_unique<Worker>();
+    }
+
+    for ( size_t i = 1; i < num_threads; ++i ) {
+      threads_.emplace_back( [this, i] { worker_loop( i ); } );
+    }
+  }
+
+  ~ParallelNetworkTraining()
+  {
+    stop_ = true;
+    start_.arrive_and_wait();
+    for ( auto& thread : threads_ ) {
+      thread.join();
+    }
+  }
+
+  ParallelNetworkTraining( const ParallelNetworkTraining& ) = delete;
+  ParallelNetworkTraining& operator=( const ParallelNetworkTraining& ) = delete;
+
+  size_t num_threads() const { return workers_.size(); }
+
+  // One gradient-descent step over the whole batch (all of `shards`)
+  void train( Network& nn,
+              const std::vector<Input>& shards,
+              const PdLossFunction& pd_loss_wrt_outputs,
+              float learning_rate )
+  {
+    if ( shards.empty() ) {
+      throw std::runtime_error( "ParallelNetworkTraining: empty batch" );
+    }
+
+    nn_ = &nn;
+    shards_ = &shards;
+    pd_loss_wrt_outputs_ = &pd_loss_wrt_outputs;
+
+    start_.arrive_and_wait();
+    run_worker( 0 );
+    done_.arrive_and_wait();
+
+    for ( auto& worker : workers_ ) {
+      if ( worker->error ) {
+        std::rethrow_exception( std::exchange( worker->error, nullptr ) );
+      }
+    }
+
+    gradient_descent_->update( nn, workers_.front()->gradients, learning_rate );
+  }
+
+private:
+  struct Worker
+  {
+    Infer infer {};
+    BackProp backprop {};
+    BackProp gradients {}; /* sum over this worker's shards */
+    bool has_gradients {};
+    std::exception_ptr error {};
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::unique_ptr<GradientDescent> gradient_descent_ = std::make_unique<GradientDescent>();
+
+  /* the current job */
+  Network* nn_ {};
+  const std::vector<Input>* shards_ {};
+  const PdLossFunction* pd_loss_wrt_outputs_ {};
+
+  std::barrier<> start_, computed_, done_;
+  bool stop_ {};
+
+  std::vector<std::thread> threads_ {};
+
+  void worker_loop( const size_t index )
+  {
+    while ( true ) {
+      start_.arrive_and_wait();
+      if ( stop_ ) {
+        return;
+      }
+      run_worker( index );
+      done_.arrive_and_wait();
+    }
+  }
+
+  void run_worker( const size_t index )
+  {
+    Worker& worker = *workers_.at( index );
+    const size_t num_workers = workers_.size();
+
+    /* forward and backward passes over this worker's shards */
+    worker.has_gradients = false;
+    try {
+      for ( size_t shard = index; shard < shards_->size(); shard += num_workers ) {
+        const Input& input = shards_->at( shard );
+        worker.infer.apply( *nn_, input );
+        worker.backprop.differentiate(
+          *nn_, input, worker.infer, ( *pd_loss_wrt_outputs_ )( worker.infer.output(), shard ) );
+
+        if ( worker.has_gradients ) {
+          accumulate_gradients<Network, shard_size>( worker.gradients, worker.backprop );
+        } else {
+          copy_gradients( worker.gradients, worker.backprop );
+          worker.has_gradients = true;
+        }
+      }
+    } catch ( ... ) {
+      worker.error = std::current_exception();
+    }
+
+    computed_.arrive_and_wait();
+
+    /* sum every worker's gradients into the first worker's, one slice per worker */
+    Worker& total = *workers_.front();
+    for ( size_t other = 1; other < num_workers; ++other ) {
+      if ( workers_[other]->has_gradients ) {
+        accumulate_gradients<Network, shard_size>( total.gradients, workers_[other]->gradients, index, num_workers );
+      }
+    }
+  }
+
+  template<NetworkT SubNetwork = Network>
+  static void copy_gradients( NetworkBackPropagation<SubNetwork, shard_size>& dest,
+                              const NetworkBackPropagation<SubNetwork, shard_size>& src )
+  {
+    dest.first.weight_gradient = src.first.weight_gradient;
+    dest.first.bias_gradient = src.first.bias_gradient;
+
+    if constexpr ( not SubNetwork::is_last ) {
+      copy_gradients<typename SubNetwork::Rest>( dest.rest, src.rest );
+    }
+  }
+};
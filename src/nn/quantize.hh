@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <cstdint>
+
+#include "network.hh"
+
+// Post-training quantization: copy a Network into a QuantizedNetwork (whose weights are stored
+// as int8_t or Eigen::half), and back. int8 weights are scaled per output, so that the largest
+// weight feeding each output maps to +/-127.
+
+static constexpr float int8_quantization_limit = 127;
+
+template<LayerT Layer, LayerT QuantizedLayer>
+void quantize_layer( const Layer& layer, QuantizedLayer& quantized )
+{
+  using T = typename Layer::type;
+  using Storage = typename QuantizedLayer::storage_type;
+
+  if constexpr ( std::same_as<Storage, int8_t> ) {
+    for ( unsigned int output = 0; output < Layer::output_size; ++output ) {
+      const T largest = layer.weights.col( output ).cwiseAbs().maxCoeff();
+      const T scale = largest > 0 ? largest / int8_quantization_limit : 1;
+
+      quantized.scales( output ) = scale;
+      quantized.weights.col( output )
+        = ( layer.weights.col( output ) / scale ).array().round().template cast<int8_t>();
+    }
+  } else {
+    quantized.weights = layer.weights.template cast<Storage>();
+    quantized.scales.setOnes();
+  }
+
+  quantized.biases = layer.biases;
+}
+
+template<LayerT QuantizedLayer, LayerT Layer>
+void dequantize_layer( const QuantizedLayer& quantized, Layer& layer )
+{
+  using T = typename Layer::type;
+
+  layer.weights = quantized.weights.template cast<T>() * quantized.scales.asDiagonal();
+  layer.biases = quantized.biases;
+}
+
+template<NetworkT Network, NetworkT QuantizedNetwork>
+void quantize( const Network& network, QuantizedNetwork& quantized )
+{
+  quantize_layer( network.first, quantized.first );
+
+  if constexpr ( not Network::is_last ) {
+    quantize( network.rest, quantized.rest );
+  }
+}
+
+template<NetworkT QuantizedNetwork, NetworkT Network>
+void dequantize( const QuantizedNetwork& quantized, Network& network )
+{
+  dequantize_layer( quantized.first, network.first );
+
+  if constexpr ( not Network::is_last ) {
+    dequantize( quantized.rest, network.rest );
+  }
+}
@@ -108,7 +108,7 @@ void serialize( const Network& network, Serializer& out )
 
   // initialize some random input
   typename Infer::Input my_input;
-  my_input.Random();
+  my_input.setRandom();
 
   // initialize output container
   Infer inference;
@@ -11,12 +11,13 @@
 #include "inference.hh"
 #include "network.hh"
 
-template<NetworkT Network, int batch_size>
+// The Optimizer is NetworkGradientDescent or one of the stateful optimizers in "optimizers.hh"
+template<NetworkT Network, int batch_size, template<class, int> class Optimizer = NetworkGradientDescent>
 struct NetworkTraining
 {
   using Infer = NetworkInference<Network, batch_size>;
   using BackProp = NetworkBackPropagation<Network, batch_size>;
-  using GradientDescent = NetworkGradientDescent<Network, batch_size>;
+  using GradientDescent = Optimizer<Network, batch_size>;
 
   using Input = typename Infer::Input;
   using Output = typename Infer::Output;
@@ -40,27 +41,57 @@ struct NetworkTraining
     gradient_descent->update( nn, *backprop, learning_rate );
   }
 
+  // How many learning rates train_with_backoff tries (each a tenth of the last) before giving up
+  static constexpr unsigned int max_backoff_attempts = 6;
+
+  // Take one gradient step, dividing the learning rate by 10 until the step no longer reverses
+  // the loss gradient. Returns the learning rate that was used, or 0 (leaving the network
+  // unchanged) if none worked. The gradients are computed once; each trial step is taken from
+  // a saved copy of the parameters. The trial steps are plain gradient descent, whatever the Optimizer.
   float train_with_backoff( Network& nn,
                             const Input& input,
                             const std::function<PdLossWrtOutputs( const Output )>& pd_loss_wrt_outputs,
                             float max_learning_rate )
   {
-    std::unique_ptr<Network> nn_backup = std::make_unique<Network>( nn );
-    float learning_rate = max_learning_rate;
-    size_t i = 0;
+    if ( not shadow ) {
+      shadow = std::make_unique<Network>();
+    }
+
     infer->apply( nn, input );
-    Output initial_gradient = pd_loss_wrt_outputs( infer->output() );
-    Output gradient;
-    do {
-      nn = *nn_backup;
-      if ( i++ > 5 ) {
-        return 0.0;
-      }
-      train( nn, input, pd_loss_wrt_outputs, learning_rate );
+    const Output initial_gradient = pd_loss_wrt_outputs( infer->output() );
+    backprop->differentiate( nn, input, *infer, initial_gradient );
+    *shadow = nn;
+
+    float learning_rate = max_learning_rate;
+    for ( unsigned int attempt = 0; attempt < max_backoff_attempts; attempt++ ) {
+      take_step_from<Network>( nn, *shadow, *backprop, learning_rate );
       infer->apply( nn, input );
+      if ( initial_gradient.dot( pd_loss_wrt_outputs( infer->output() ) ) >= 0 ) {
+        return learning_rate;
+      }
       learning_rate /= 10;
-      gradient = pd_loss_wrt_outputs( infer->output() );
-    } while ( initial_gradient.dot( gradient ) < 0 );
-    return learning_rate * 10;
+    }
+
+    nn = *shadow;
+    return 0.0;
+  }
+
+private:
+  // The parameters from before the step, kept between calls to train_with_backoff
+  std::unique_ptr<Network> shadow {};
+
+  // nn = origin - learning_rate * gradient, in one pass over the parameters
+  template<NetworkT SubNetwork>
+  static void take_step_from( SubNetwork& nn,
+                              const SubNetwork& origin,
+                              const NetworkBackPropagation<SubNetwork, batch_size>& gradients,
+                              float learning_rate )
+  {
+    nn.first.weights.noalias() = origin.first.weights - learning_rate * gradients.first.weight_gradient;
+    nn.first.biases.noalias() = origin.first.biases - learning_rate * gradients.first.bias_gradient;
+
+    if constexpr ( not SubNetwork::is_last ) {
+      take_step_from<typename SubNetwork::Rest>( nn.rest, origin.rest, gradients.rest, learning_rate );
+    }
   }
 };
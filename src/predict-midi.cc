@@ -1,8 +1,9 @@
 #include "autoencoder.hh"
 #include "backprop.hh"
+#include "batch_queue.hh"
 #include "dnn_types.hh"
 #include "inference.hh"
-#include "midi_file.hh"
+#include "midi_corpus.hh"
 #include "piano_roll.hh"
 #include "randomize_network.hh"
 #include "serdes.hh"
@@ -18,9 +19,9 @@
 
 using namespace std;
 
-// Input generation parameters
-static auto prng = get_random_engine();
-static vector<MidiFile> midi_files {};
+// Input generation parameters (the random engine is per thread, for the BatchQueue's producer)
+static thread_local auto prng = get_random_engine();
+static unique_ptr<MidiCorpus> midi_files {};
 
 // Training parameters
 static constexpr float TARGET_ACCURACY = 0.99;
@@ -38,27 +39,56 @@ using Input = typename Infer::Input;
 
 using Single = Eigen::Matrix<double, 88, 1>;
 
+// A batch of training examples, prepared ahead of the training loop by a BatchQueue
+struct Batch
+{
+  Input input {};
+  Output expected {};
+  string name {};
+  bool trivial {};
+};
+
 void generate_datum( array<Single, HISTORY>& input, Single& output, string& name )
 {
-  const auto& midi = midi_files[uniform_int_distribution<size_t>( 0, midi_files.size() - 1 )( prng )];
+  const auto& midi = ( *midi_files )[uniform_int_distribution<size_t>( 0, midi_files->size() - 1 )( prng )];
   name = midi.name;
-  const PianoRoll<128>& roll = midi.piano_roll();
+  const PackedPianoRoll& roll = midi.piano_roll();
   const ssize_t start_index = uniform_int_distribution<ssize_t>( 0, roll.size() - 1 )( prng ) - HISTORY;
 
   for ( size_t i = 0; i < HISTORY; i++ ) {
-    for ( size_t key = 0; key < 88; key++ ) {
-      if ( (ssize_t)i + start_index < 0 ) {
-        input[i][key] = PianoRollEvent::Unknown;
-      } else {
-        input[i][key] = roll[i + start_index][key + 21];
-      }
+    if ( (ssize_t)i + start_index < 0 ) {
+      input[i].setConstant( PianoRollEvent::Unknown );
+    } else {
+      roll[i + start_index].unpack( 21, input[i] );
     }
   }
-  for ( size_t key = 0; key < 88; key++ ) {
-    output[key] = roll[start_index + HISTORY][key + 21];
-  }
+  roll[start_index + HISTORY].unpack( 21, output );
 };
 
+// Fill a batch with random examples (called on the BatchQueue's producer thread)
+void fill_batch( Batch& batch )
+{
+  array<Single, HISTORY> raw_input;
+  Single raw_expected;
+
+  batch.trivial = true;
+  for ( size_t row = 0; row < BATCH; row++ ) {
+    generate_datum( raw_input, raw_expected, batch.name );
+    for ( size_t i = 0; i < HISTORY; i++ ) {
+      Single single = raw_input[HISTORY - 1 - i];
+      size_t index = i;
+      for ( size_t j = 0; j < 88; j++ ) {
+        batch.input( row, index ) = single[j];
+        index += HISTORY;
+      }
+    }
+    if ( raw_expected != raw_input.back() ) {
+      batch.trivial = false;
+    }
+    batch.expected.row( row ) = raw_expected;
+  }
+}
+
 template<size_t N>
 struct AccuracyMeasurement
 {
@@ -112,10 +142,8 @@ void program_body( ostream& outstream )
   auto expected_ptr = make_unique<Output>();
   Output& expected = *expected_ptr;
 
-  auto raw_input_ptr = make_unique<array<Single, HISTORY>>();
-  auto raw_expected_ptr = make_unique<Single>();
-  array<Single, HISTORY>& raw_input = *raw_input_ptr;
-  Single& raw_expected = *raw_expected_ptr;
+  /* the next batch is prepared while this one trains */
+  BatchQueue<Batch> batches { fill_batch };
 
   auto train = make_unique<Training>();
   size_t iteration = 0;
@@ -125,22 +153,11 @@ void program_body( ostream& outstream )
     auto start = steady_clock::now();
     string name;
 
-    bool trivial = true;
-    for ( size_t batch = 0; batch < BATCH; batch++ ) {
-      generate_datum( raw_input, raw_expected, name );
-      for ( size_t i = 0; i < HISTORY; i++ ) {
-        Single single = raw_input[HISTORY - i];
-        size_t index = i;
-        for ( size_t j = 0; j < 88; j++ ) {
-          input( batch, index ) = single[j];
-          index += HISTORY;
-        }
-      }
-      if ( raw_expected != raw_input.back() ) {
-        trivial = false;
-      }
-      expected.row( batch ) = raw_expected;
-    }
+    const Batch& batch = batches.next();
+    input = batch.input;
+    expected = batch.expected;
+    name = batch.name;
+    const bool trivial = batch.trivial;
 
     auto infer = make_unique<Infer>();
     infer->apply( nn, input );
@@ -279,31 +296,19 @@ int main( int argc, char* argv[] )
     return EXIT_FAILURE;
   }
 
-  string midi_directory = argv[1];
-
   try {
-    for ( const auto& entry : filesystem::directory_iterator( midi_directory ) ) {
-      if ( entry.path().extension() == ".mid" ) {
-        cout << "Using file: " << entry.path() << "\n";
-        midi_files.emplace_back( MidiFile( entry.path() ) );
-        if ( midi_files.back().tracks().size() == 0 ) {
-          cout << "No tracks found; skipping!"
-               << "\n";
-          midi_files.pop_back();
-        }
-      }
-    }
+    midi_files = make_unique<MidiCorpus>( argv[1] );
   } catch ( const filesystem::filesystem_error& e ) {
     cerr << "Error finding midi files:\n";
     cerr << e.what() << endl;
     return EXIT_FAILURE;
   }
 
-  if ( midi_files.empty() ) {
+  if ( midi_files->empty() ) {
     cerr << "No midi files found!" << endl;
     return EXIT_FAILURE;
   }
-  cout << "Got " << midi_files.size() << " midi files.\n";
+  cout << "Got " << midi_files->size() << " midi files.\n";
 
   string filename = argv[2];
 
@@ -0,0 +1,167 @@
+#include "binary_network.hh"
+#include "dnn_types.hh"
+#include "inference.hh"
+#include "mmap.hh"
+#include "quantize.hh"
+#include "timer.hh"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string_view>
+
+using namespace std;
+
+// Roughly how many multiply-adds to spend on each latency measurement
+static constexpr double work_per_measurement = 2e8;
+
+template<NetworkT Network, int batch_size>
+static double ns_per_inference( const Network& nn, const typename NetworkInference<Network, batch_size>::Input& input )
+{
+  using Infer = NetworkInference<Network, batch_size>;
+
+  auto infer = make_unique<Infer>();
+  const size_t iterations = max( 10.0, work_per_measurement / ( Network::num_params * batch_size ) );
+
+  infer->apply( nn, input ); /* warm up */
+
+  const uint64_t start = Timer::timestamp_ns();
+  for ( size_t i = 0; i < iterations; i++ ) {
+    infer->apply( nn, input );
+  }
+  const uint64_t elapsed_ns = Timer::timestamp_ns() - start;
+
+  return double( elapsed_ns ) / iterations;
+}
+
+// Compare one version of the network with the original, on the same random inputs
+template<NetworkT Network, NetworkT Variant>
+static void report( const Network& original, const Variant& variant, const string_view name )
+{
+  using Infer = NetworkInference<Network, BATCH_SIZE>;
+  using VariantInfer = NetworkInference<Variant, BATCH_SIZE>;
+
+  auto input = make_unique<typename Infer::Input>();
+  input->setRandom();
+  auto single_input = make_unique<typename NetworkInference<Network, 1>::Input>( input->row( 0 ) );
+
+  auto infer = make_unique<Infer>();
+  auto variant_infer = make_unique<VariantInfer>();
+  infer->apply( original, *input );
+  variant_infer->apply( variant, *input );
+
+  const auto error = ( variant_infer->output() - infer->output() ).array().abs().eval();
+  const double scale = infer->output().array().abs().maxCoeff();
+
+  cout << "   " << name << string( 8 - name.size(), ' ' );
+  cout << "weights=" << setw( 9 ) << NetworkBinary::parameter_bytes<Variant>() << " bytes";
+  cout << "   max error=" << setprecision( 3 ) << setw( 9 ) << error.maxCoeff();
+  cout << " (" << setw( 9 ) << ( scale > 0 ? error.maxCoeff() / scale : 0 ) << " of max output)";
+  cout << "   rms error=" << setw( 9 ) << sqrt( error.square().mean() );
+  cout << "   latency batch=1: ";
+  Timer::pp_ns( cout, ns_per_inference<Variant, 1>( variant, *single_input ) );
+  cout << "   batch=" << BATCH_SIZE << ": ";
+  Timer::pp_ns( cout, ns_per_inference<Variant, BATCH_SIZE>( variant, *input ) );
+  cout << "\n";
+}
+
+// Quantize a network (in either file format), report its accuracy and latency against the
+// original, and write it in the binary format
+template<NetworkT Network>
+static void quantize_file( const string& input_filename, const string_view encoding, ostream& output )
+{
+  using Int8 = typename Network::template Quantized<int8_t>;
+  using Float16 = typename Network::template Quantized<Eigen::half>;
+
+  if ( encoding != "int8" and encoding != "fp16" ) {
+    throw runtime_error( "unknown encoding: " + string( encoding ) );
+  }
+
+  auto nn = make_unique<Network>();
+  {
+    ReadOnlyFile dnn_on_disk { input_filename };
+    NetworkBinary::load( *nn, dnn_on_disk );
+  }
+
+  auto int8 = make_unique<Int8>();
+  auto float16 = make_unique<Float16>();
+  quantize( *nn, *int8 );
+  quantize( *nn, *float16 );
+
+  cout << "Accuracy and latency against the original, on " << BATCH_SIZE << " random inputs\n\n";
+  report( *nn, *nn, "original" );
+  report( *nn, *int8, "int8" );
+  report( *nn, *float16, "fp16" );
+
+  const string binary
+    = encoding == "int8" ? NetworkBinary::serialize( *int8 ) : NetworkBinary::serialize( *float16 );
+
+  output << binary;
+  cout << "\nOutput is " << binary.size() << " bytes.\n";
+}
+
+static bool quantize_file( const string_view type,
+                           const string& input_filename,
+                           const string_view encoding,
+                           ostream& output )
+{
+  if ( type == "DNN" ) {
+    quantize_file<DNN>( input_filename, encoding, output );
+  } else if ( type == "DNN_timestamp" ) {
+    quantize_file<DNN_timestamp>( input_filename, encoding, output );
+  } else if ( type == "DNN_tempo" ) {
+    quantize_file<DNN_tempo>( input_filename, encoding, output );
+  } else if ( type == "DNN_period" ) {
+    quantize_file<DNN_period>( input_filename, encoding, output );
+  } else if ( type == "DNN_period_16" ) {
+    quantize_file<DNN_period_16>( input_filename, encoding, output );
+  } else if ( type == "DNN_period_phase" ) {
+    quantize_file<DNN_period_phase>( input_filename, encoding, output );
+  } else if ( type == "DNN_piano_roll_rhythm_prediction" ) {
+    quantize_file<DNN_piano_roll_rhythm_prediction>( input_filename, encoding, output );
+  } else if ( type == "DNN_piano_roll_octave_prediction" ) {
+    quantize_file<DNN_piano_roll_octave_prediction>( input_filename, encoding, output );
+  } else if ( type == "DNN_piano_roll_compressor" ) {
+    quantize_file<DNN_piano_roll_compressor>( input_filename, encoding, output );
+  } else if ( type == "DNN_piano_roll_prediction" ) {
+    quantize_file<DNN_piano_roll_prediction>( input_filename, encoding, output );
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 5 ) {
+    cerr << "Usage: " << argv[0] << " network_type input_filename output_filename int8|fp16\n";
+    return EXIT_FAILURE;
+  }
+
+  ofstream output;
+  output.open( argv[3], ios::binary );
+
+  if ( !output.is_open() ) {
+    cerr << "Unable to open file '" << argv[3] << "' for writing." << endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    if ( not quantize_file( argv[1], argv[2], argv[4], output ) ) {
+      cerr << "Unknown network type '" << argv[1] << "'.\n";
+      return EXIT_FAILURE;
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+#include "backprop.hh"
+#include "dnn_types.hh"
+#include "inference.hh"
+#include "random.hh"
+#include "timer.hh"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+
+using namespace std;
+
+// Count every heap allocation, to check that a backpropagation step makes none
+static size_t allocation_count = 0;
+
+void* operator new( size_t size )
+{
+  allocation_count++;
+  if ( void* ptr = malloc( size ) ) {
+    return ptr;
+  }
+  throw bad_alloc();
+}
+
+void operator delete( void* ptr ) noexcept
+{
+  free( ptr );
+}
+
+void operator delete( void* ptr, size_t ) noexcept
+{
+  free( ptr );
+}
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  normal_distribution<float> parameter_distribution { 0.0, 0.1 };
+
+  float sample() { return parameter_distribution( prng ); }
+};
+
+template<LayerT Layer>
+void randomize_layer( Layer& layer, RandomState& rng )
+{
+  for ( unsigned int i = 0; i < layer.weights.size(); ++i ) {
+    *( layer.weights.data() + i ) = rng.sample();
+  }
+
+  for ( unsigned int i = 0; i < layer.biases.size(); ++i ) {
+    *( layer.biases.data() + i ) = rng.sample();
+  }
+}
+
+template<NetworkT Network>
+void randomize_network( Network& network, RandomState& rng )
+{
+  randomize_layer( network.first, rng );
+
+  if constexpr ( not Network::is_last ) {
+    randomize_network( network.rest, rng );
+  }
+}
+
+// The first layer's gradients, computed the straightforward way (with temporaries)
+template<NetworkT Network, int batch_size>
+void check_first_layer( const typename NetworkInference<Network, batch_size>::Input& input,
+                        const NetworkInference<Network, batch_size>& infer,
+                        const NetworkBackPropagation<Network, batch_size>& backprop,
+                        const string& name )
+{
+  using T = typename Network::type;
+  using LayerOutput = typename LayerInference<typename Network::Layer0, batch_size>::Output;
+
+  auto pd_activation = make_unique<LayerOutput>(
+    infer.first.output.unaryExpr( []( const T val ) -> T { return val > 0 ? 1.0 : leaky_constant; } ) );
+  auto error = make_unique<LayerOutput>( backprop.rest.first.weight_times_error.cwiseProduct( *pd_activation ) );
+  auto weight_gradient = make_unique<typename Network::Layer0::Weights>( input.transpose() * *error );
+
+  const double scale = max( 1.0, double( weight_gradient->cwiseAbs().maxCoeff() ) );
+  if ( ( *weight_gradient - backprop.first.weight_gradient ).cwiseAbs().maxCoeff() > 1e-4 * scale
+       or ( error->colwise().sum() - backprop.first.bias_gradient ).cwiseAbs().maxCoeff() > 1e-4 * scale ) {
+    throw runtime_error( name + ": backpropagation gradients are wrong" );
+  }
+}
+
+constexpr size_t iteration_count = 32;
+
+template<NetworkT Network, int batch_size>
+void benchmark( const string& name, RandomState& rng )
+{
+  using Infer = NetworkInference<Network, batch_size>;
+  using BackProp = NetworkBackPropagation<Network, batch_size>;
+
+  auto nn = make_unique<Network>();
+  randomize_network( *nn, rng );
+  auto input = make_unique<typename Infer::Input>();
+  input->setRandom();
+  auto pd_loss_wrt_outputs = make_unique<typename Infer::Output>();
+  pd_loss_wrt_outputs->setRandom();
+
+  auto infer = make_unique<Infer>();
+  auto backprop = make_unique<BackProp>();
+  infer->apply( *nn, *input );
+
+  const size_t allocations_before = allocation_count;
+  const uint64_t start = Timer::timestamp_ns();
+  for ( size_t i = 0; i < iteration_count; i++ ) {
+    backprop->differentiate( *nn, *input, *infer, *pd_loss_wrt_outputs );
+  }
+  const uint64_t elapsed_ns = Timer::timestamp_ns() - start;
+
+  if ( allocation_count != allocations_before ) {
+    throw runtime_error( name + ": backpropagation allocated memory" );
+  }
+
+  check_first_layer<Network, batch_size>( *input, *infer, *backprop, name );
+
+  cout << "   " << name << string( 36 - name.size(), ' ' ) << "batch=" << setw( 3 ) << batch_size;
+  cout << "   backprop=";
+  Timer::pp_ns( cout, double( elapsed_ns ) / iteration_count );
+  cout << "\n";
+}
+
+void program_body()
+{
+  RandomState rng;
+
+  cout << "Backpropagation time per batch (no allocations)\n\n";
+
+  benchmark<DNN, BATCH_SIZE>( "DNN", rng );
+  benchmark<DNN_period_16, 1>( "DNN_period_16", rng );
+  benchmark<DNN_period_16, BATCH_SIZE>( "DNN_period_16", rng );
+  benchmark<DNN_piano_roll_octave_prediction, BATCH_SIZE>( "DNN_piano_roll_octave_prediction", rng );
+  benchmark<DNN_piano_roll_prediction, 1>( "DNN_piano_roll_prediction", rng );
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
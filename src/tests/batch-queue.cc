@@ -0,0 +1,98 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+#include "batch_queue.hh"
+
+using namespace std;
+
+static constexpr size_t BATCH_COUNT = 10000;
+static constexpr size_t DEPTH = 3;
+
+struct Batch
+{
+  size_t serial {};
+  size_t checksum {};
+};
+
+void program_body()
+{
+  /* every filled batch is delivered once, and no more than DEPTH are ever filled and unconsumed */
+  {
+    atomic<size_t> next_serial { 0 }, outstanding { 0 }, max_outstanding { 0 };
+
+    BatchQueue<Batch> queue {
+      [&]( Batch& batch ) {
+        batch.serial = next_serial++;
+        batch.checksum = batch.serial * 7 + 1;
+        const size_t now = ++outstanding;
+        size_t seen = max_outstanding;
+        while ( now > seen and not max_outstanding.compare_exchange_weak( seen, now ) ) {}
+      },
+      DEPTH,
+      2 };
+
+    set<size_t> serials;
+    for ( size_t i = 0; i < BATCH_COUNT; i++ ) {
+      const Batch& batch = queue.next();
+      outstanding--;
+      if ( batch.checksum != batch.serial * 7 + 1 ) {
+        throw runtime_error( "batch was modified while in use" );
+      }
+      if ( not serials.insert( batch.serial ).second ) {
+        throw runtime_error( "batch delivered twice" );
+      }
+    }
+
+    if ( max_outstanding > DEPTH ) {
+      throw runtime_error( "more batches filled than the queue's depth" );
+    }
+  }
+
+  /* an exception from the producer reaches the consumer */
+  {
+    size_t filled = 0;
+    BatchQueue<Batch> queue { [&]( Batch& batch ) {
+      if ( filled == 5 ) {
+        throw runtime_error( "expected failure" );
+      }
+      batch.serial = filled++;
+    } };
+
+    try {
+      for ( size_t i = 0; i < 10; i++ ) {
+        queue.next();
+      }
+    } catch ( const runtime_error& e ) {
+      if ( string( e.what() ) != "expected failure" ) {
+        throw;
+      }
+      return;
+    }
+
+    throw runtime_error( "producer exception was lost" );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
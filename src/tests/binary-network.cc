@@ -0,0 +1,137 @@
+#include "binary_network.hh"
+#include "dnn_types.hh"
+#include "inference.hh"
+#include "random.hh"
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <unistd.h>
+
+using namespace std;
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  normal_distribution<float> parameter_distribution { 0.0, 0.1 };
+
+  float sample() { return parameter_distribution( prng ); }
+};
+
+template<LayerT Layer>
+void randomize_layer( Layer& layer, RandomState& rng )
+{
+  for ( unsigned int i = 0; i < layer.weights.size(); ++i ) {
+    *( layer.weights.data() + i ) = rng.sample();
+  }
+
+  for ( unsigned int i = 0; i < layer.biases.size(); ++i ) {
+    *( layer.biases.data() + i ) = rng.sample();
+  }
+}
+
+template<NetworkT Network>
+void randomize_network( Network& network, RandomState& rng )
+{
+  randomize_layer( network.first, rng );
+
+  if constexpr ( not Network::is_last ) {
+    randomize_network( network.rest, rng );
+  }
+}
+
+template<NetworkT Network>
+void expect_failure( Network& network, const string_view file, const string_view what )
+{
+  try {
+    NetworkBinary::parse( network, file, true );
+  } catch ( const exception& ) {
+    return;
+  }
+
+  throw runtime_error( "binary network: accepted " + string( what ) );
+}
+
+using TestNetwork = DNN_timestamp;
+constexpr int batch_size = 4;
+
+void program_body()
+{
+  RandomState rng;
+
+  auto nn = make_unique<TestNetwork>();
+  randomize_network( *nn, rng );
+
+  const string binary = NetworkBinary::serialize( *nn );
+  if ( not NetworkBinary::is_binary( binary ) ) {
+    throw runtime_error( "binary network: missing magic" );
+  }
+
+  /* parse copies the parameters exactly, and the roundtrip examples check out */
+  auto parsed = make_unique<TestNetwork>();
+  NetworkBinary::parse( *parsed, binary, true );
+  if ( not( *parsed == *nn ) ) {
+    throw runtime_error( "binary network: parsed network differs" );
+  }
+
+  /* a file without roundtrip examples still loads (and can't be roundtrip-checked) */
+  const string bare = NetworkBinary::serialize( *nn, false );
+  NetworkBinary::parse( *parsed, bare );
+  expect_failure( *parsed, bare, "a roundtrip check without examples" );
+
+  /* corruption and mismatched shapes are caught */
+  string corrupted = binary;
+  corrupted[NetworkBinary::parameter_alignment * 2] ^= 1;
+  expect_failure( *parsed, corrupted, "a corrupted parameter block" );
+  expect_failure( *parsed, binary.substr( 0, binary.size() / 2 ), "a truncated file" );
+  auto other = make_unique<DNN_tempo>();
+  expect_failure( *other, binary, "the wrong network type" );
+
+  /* the mapped network is used in place and infers exactly like the original */
+  char filename[] = "/tmp/binary-network-XXXXXX";
+  const int fd = mkstemp( filename );
+  if ( fd < 0 ) {
+    throw runtime_error( "mkstemp failed" );
+  }
+  close( fd );
+  {
+    ofstream output { filename, ios::binary };
+    output << binary;
+  }
+  auto mapped = make_unique<NetworkBinary::MappedFile<TestNetwork>>( filename, true );
+  unlink( filename );
+
+  using Infer = NetworkInference<TestNetwork, batch_size>;
+  using MappedInfer = NetworkInference<TestNetwork::Mapped, batch_size>;
+  auto input = make_unique<typename Infer::Input>();
+  input->setRandom();
+  auto infer = make_unique<Infer>();
+  auto mapped_infer = make_unique<MappedInfer>();
+  infer->apply( *nn, *input );
+  mapped_infer->apply( mapped->network(), *input );
+
+  if ( infer->output() != mapped_infer->output() ) {
+    throw runtime_error( "binary network: mapped inference differs" );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+#include "binary_network.hh"
+#include "dnn_types.hh"
+#include "dynamic_network.hh"
+#include "inference.hh"
+#include "random.hh"
+
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  normal_distribution<float> parameter_distribution { 0.0, 0.1 };
+
+  float sample() { return parameter_distribution( prng ); }
+};
+
+template<LayerT Layer>
+void randomize_layer( Layer& layer, RandomState& rng )
+{
+  for ( unsigned int i = 0; i < layer.weights.size(); ++i ) {
+    *( layer.weights.data() + i ) = rng.sample();
+  }
+
+  for ( unsigned int i = 0; i < layer.biases.size(); ++i ) {
+    *( layer.biases.data() + i ) = rng.sample();
+  }
+}
+
+template<NetworkT Network>
+void randomize_network( Network& network, RandomState& rng )
+{
+  randomize_layer( network.first, rng );
+
+  if constexpr ( not Network::is_last ) {
+    randomize_network( network.rest, rng );
+  }
+}
+
+// A DynamicNetwork must produce the same outputs as the Network it was copied from
+template<NetworkT Network, int batch_size>
+void check_inference( const Network& nn, const DynamicNetwork<typename Network::type>& dynamic, const string& name )
+{
+  using Infer = NetworkInference<Network, batch_size>;
+  using DynamicInfer = DynamicNetworkInference<typename Network::type, batch_size>;
+
+  auto input = make_unique<typename Infer::Input>();
+  input->setRandom();
+
+  auto infer = make_unique<Infer>();
+  infer->apply( nn, *input );
+
+  DynamicInfer dynamic_infer { dynamic };
+  dynamic_infer.apply( dynamic, *input );
+
+  const double scale = max( 1.0, double( infer->output().cwiseAbs().maxCoeff() ) );
+  if ( ( dynamic_infer.output() - infer->output() ).cwiseAbs().maxCoeff() > 1e-5 * scale ) {
+    throw runtime_error( name + ": dynamic inference does not match (batch size " + to_string( batch_size )
+                         + ")" );
+  }
+}
+
+template<NetworkT Network>
+void test_network( const string& name, RandomState& rng )
+{
+  using T = typename Network::type;
+
+  auto nn = make_unique<Network>();
+  randomize_network( *nn, rng );
+
+  const DynamicNetwork<T> copied { *nn };
+  check_inference<Network, 1>( *nn, copied, name );
+  check_inference<Network, 16>( *nn, copied, name );
+
+  /* the shape comes from the file's header */
+  const string binary = NetworkBinary::serialize( *nn );
+  const DynamicNetwork<T> loaded = NetworkBinary::load_dynamic<T>( binary, true );
+  if ( not( loaded == copied ) ) {
+    throw runtime_error( name + ": loaded dynamic network differs from the original" );
+  }
+
+  if ( loaded.sizes() != DynamicNetwork<T>::template layer_sizes<Network>() ) {
+    throw runtime_error( name + ": loaded dynamic network has the wrong shape" );
+  }
+
+  /* inference workspaces are for one shape only */
+  const DynamicNetwork<T> other { vector<size_t> { Network::input_size, 3, Network::output_size } };
+  DynamicNetworkInference<T, 1> other_infer { other };
+  auto input = make_unique<typename NetworkInference<Network, 1>::Input>();
+  input->setRandom();
+  try {
+    other_infer.apply( loaded, *input );
+  } catch ( const exception& ) {
+    return;
+  }
+  throw runtime_error( name + ": dynamic inference accepted a network of the wrong shape" );
+}
+
+void program_body()
+{
+  RandomState rng;
+
+  test_network<DNN>( "DNN", rng );
+  test_network<DNN_timestamp>( "DNN_timestamp", rng );
+  test_network<DNN_period_16>( "DNN_period_16", rng );
+  test_network<DNN_piano_roll_octave_prediction>( "DNN_piano_roll_octave_prediction", rng );
+  test_network<DNN_piano_roll_prediction>( "DNN_piano_roll_prediction", rng );
+
+  /* a file of the wrong parameter type is refused */
+  auto nn = make_unique<DNN_tempo>();
+  randomize_network( *nn, rng );
+  try {
+    NetworkBinary::load_dynamic<double>( NetworkBinary::serialize( *nn ) );
+  } catch ( const exception& ) {
+    return;
+  }
+  throw runtime_error( "dynamic network: loaded float parameters as double" );
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
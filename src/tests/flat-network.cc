@@ -0,0 +1,119 @@
+#include "dnn_types.hh"
+#include "flat_network.hh"
+#include "random.hh"
+#include "training.hh"
+
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  normal_distribution<float> parameter_distribution { 0.0, 0.1 };
+
+  float sample() { return parameter_distribution( prng ); }
+};
+
+template<LayerT Layer>
+void randomize_layer( Layer& layer, RandomState& rng )
+{
+  for ( unsigned int i = 0; i < layer.weights.size(); ++i ) {
+    *( layer.weights.data() + i ) = rng.sample();
+  }
+
+  for ( unsigned int i = 0; i < layer.biases.size(); ++i ) {
+    *( layer.biases.data() + i ) = rng.sample();
+  }
+}
+
+template<NetworkT Network>
+void randomize_network( Network& network, RandomState& rng )
+{
+  randomize_layer( network.first, rng );
+
+  if constexpr ( not Network::is_last ) {
+    randomize_network( network.rest, rng );
+  }
+}
+
+using TestNetwork = DNN_timestamp;
+constexpr int batch_size = 4;
+constexpr size_t iteration_count = 8;
+constexpr float learning_rate = 0.001;
+
+// A FlatNetwork must behave exactly like the Network it was loaded from
+void program_body()
+{
+  RandomState rng;
+
+  auto nn = make_unique<TestNetwork>();
+  randomize_network( *nn, rng );
+
+  auto flat = make_unique<FlatNetwork<TestNetwork>>( *nn );
+
+  /* the buffer is the serialization order: layer 0's weights, then its biases, ... */
+  if ( flat->data()[0] != nn->first.weights( 0, 0 ) or flat->data()[1] != nn->first.weights( 1, 0 )
+       or flat->data()[TestNetwork::Layer0::input_size * TestNetwork::Layer0::output_size]
+            != nn->first.biases( 0 )
+       or flat->data()[TestNetwork::Layer0::num_params] != nn->rest.first.weights( 0, 0 ) ) {
+    throw runtime_error( "FlatNetwork parameters are out of order" );
+  }
+
+  using Training = NetworkTraining<TestNetwork, batch_size>;
+  using FlatTraining = NetworkTraining<TestNetwork::Mapped, batch_size>;
+  auto training = make_unique<Training>();
+  auto flat_training = make_unique<FlatTraining>();
+
+  auto input = make_unique<typename Training::Input>();
+  auto expected = make_unique<typename Training::Output>();
+
+  for ( size_t i = 0; i < iteration_count; ++i ) {
+    input->setRandom();
+    expected->setRandom();
+
+    training->train(
+      *nn, *input, [&]( const auto& predicted ) { return predicted - *expected; }, learning_rate );
+    flat_training->train(
+      flat->network(), *input, [&]( const auto& predicted ) { return predicted - *expected; }, learning_rate );
+
+    if ( training->infer->output() != flat_training->infer->output() ) {
+      throw runtime_error( "FlatNetwork inference differs from Network inference" );
+    }
+  }
+
+  auto stored = make_unique<TestNetwork>();
+  flat->store( *stored );
+  if ( not( *stored == *nn ) ) {
+    throw runtime_error( "FlatNetwork training differs from Network training" );
+  }
+
+  /* snapshots are independent copies */
+  auto snapshot = make_unique<FlatNetwork<TestNetwork>>( *flat );
+  flat->parameters() *= 2;
+  if ( *snapshot == *flat or not( snapshot->parameters() * 2 == flat->parameters() ) ) {
+    throw runtime_error( "FlatNetwork snapshot is not independent" );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
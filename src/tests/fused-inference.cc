@@ -0,0 +1,99 @@
+#include "dnn_types.hh"
+#include "inference.hh"
+#include "random.hh"
+
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  normal_distribution<float> parameter_distribution { 0.0, 1.0 };
+
+  float sample() { return parameter_distribution( prng ); }
+};
+
+template<LayerT Layer>
+void randomize_layer( Layer& layer, RandomState& rng )
+{
+  for ( unsigned int i = 0; i < layer.weights.size(); ++i ) {
+    *( layer.weights.data() + i ) = rng.sample();
+  }
+
+  for ( unsigned int i = 0; i < layer.biases.size(); ++i ) {
+    *( layer.biases.data() + i ) = rng.sample();
+  }
+}
+
+template<NetworkT Network>
+void randomize_network( Network& network, RandomState& rng )
+{
+  randomize_layer( network.first, rng );
+
+  if constexpr ( not Network::is_last ) {
+    randomize_network( network.rest, rng );
+  }
+}
+
+constexpr size_t iteration_count = 16;
+
+// The fused epilogue must produce the same activations as the two-pass path
+template<NetworkT Network, int batch_size>
+void test_network( const string& name, RandomState& rng )
+{
+  using TwoPass = NetworkInference<Network, batch_size, Epilogue::TwoPass>;
+  using Fused = NetworkInference<Network, batch_size, Epilogue::Fused>;
+
+  auto nn = make_unique<Network>();
+  auto input = make_unique<typename TwoPass::Input>();
+  auto two_pass = make_unique<TwoPass>();
+  auto fused = make_unique<Fused>();
+
+  for ( size_t i = 0; i < iteration_count; ++i ) {
+    randomize_network( *nn, rng );
+    input->setRandom();
+
+    two_pass->apply( *nn, *input );
+    fused->apply( *nn, *input );
+
+    const double scale = max( 1.0, double( two_pass->output().cwiseAbs().maxCoeff() ) );
+    if ( ( two_pass->output() - fused->output() ).cwiseAbs().maxCoeff() > 1e-5 * scale ) {
+      throw runtime_error( "fused inference does not match two-pass inference for " + name + " (batch size "
+                           + to_string( batch_size ) + ")" );
+    }
+  }
+}
+
+void program_body()
+{
+  RandomState rng;
+
+  test_network<DNN, 1>( "DNN", rng );
+  test_network<DNN_period_16, 1>( "DNN_period_16", rng );
+  test_network<DNN_period_16, BATCH_SIZE>( "DNN_period_16", rng );
+  test_network<DNN_piano_roll_octave_prediction, BATCH_SIZE>( "DNN_piano_roll_octave_prediction", rng );
+  test_network<DNN_piano_roll_prediction, 1>( "DNN_piano_roll_prediction", rng );
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
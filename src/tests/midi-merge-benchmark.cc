@@ -0,0 +1,144 @@
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "midi_file.hh"
+#include "random.hh"
+#include "timer.hh"
+
+using namespace std;
+
+static constexpr size_t TRACK_COUNT = 100;
+static constexpr size_t NOTES_PER_TRACK = 1000;
+
+static void append_variable_length( string& out, uint32_t value )
+{
+  string reversed( 1, char( value & 0x7F ) );
+  while ( value >>= 7 ) {
+    reversed.push_back( char( ( value & 0x7F ) | 0x80 ) );
+  }
+  out.append( reversed.rbegin(), reversed.rend() );
+}
+
+static string chunk( const string& type, const string& body )
+{
+  string ret = type;
+  for ( int shift = 24; shift >= 0; shift -= 8 ) {
+    ret.push_back( char( ( body.size() >> shift ) & 0xff ) );
+  }
+  return ret + body;
+}
+
+/* an orchestral-sized file: a tempo track, then many tracks of notes at random times */
+static string synthetic_file()
+{
+  default_random_engine prng { get_random_engine() };
+  uniform_int_distribution<uint32_t> delta { 0, 480 }, key { 21, 108 }, velocity { 1, 127 };
+
+  string file = chunk( "MThd", { 0, 1, 0, char( TRACK_COUNT + 1 ), 0x01, char( 0xE0 ) } );
+  file += chunk( "MTrk", { 0, char( 0xFF ), 0x51, 0x03, 0x07, char( 0xA1 ), 0x20, 0, char( 0xFF ), 0x2F, 0 } );
+
+  for ( size_t track = 0; track < TRACK_COUNT; track++ ) {
+    string body;
+    for ( size_t note = 0; note < NOTES_PER_TRACK; note++ ) {
+      const char channel = char( track % 16 ), k = char( key( prng ) );
+      append_variable_length( body, delta( prng ) );
+      body += { char( 0x90 | channel ), k, char( velocity( prng ) ) };
+      append_variable_length( body, delta( prng ) );
+      body += { char( 0x80 | channel ), k, 0 };
+    }
+    body += { 0, char( 0xFF ), 0x2F, 0 };
+    file += chunk( "MTrk", body );
+  }
+
+  return file;
+}
+
+/* the merge as it used to be done: find the earliest track, then take its ticks off every track */
+static vector<MidiEvent> linear_merge( const vector<MidiTrack>& tracks )
+{
+  vector<deque<MidiEvent>> remaining;
+  for ( const auto& track : tracks ) {
+    remaining.emplace_back( track.events().begin(), track.events().end() );
+  }
+
+  vector<MidiEvent> ret;
+  while ( not remaining.empty() ) {
+    size_t min_idx = 0;
+    for ( size_t i = 0; i < remaining.size(); i++ ) {
+      if ( remaining[i].front().ticks < remaining[min_idx].front().ticks ) {
+        min_idx = i;
+      }
+    }
+
+    const uint32_t ticks = remaining[min_idx].front().ticks;
+    ret.push_back( remaining[min_idx].front() );
+    for ( auto& track : remaining ) {
+      track.front().ticks -= ticks;
+    }
+
+    remaining[min_idx].pop_front();
+    if ( remaining[min_idx].empty() ) {
+      remaining.erase( remaining.begin() + min_idx );
+    }
+  }
+
+  return ret;
+}
+
+void program_body()
+{
+  const string file = synthetic_file();
+
+  const uint64_t start = Timer::timestamp_ns();
+  const MidiFile midi { "synthetic", file };
+  const uint64_t parse_ns = Timer::timestamp_ns() - start;
+
+  const uint64_t linear_start = Timer::timestamp_ns();
+  const vector<MidiEvent> expected = linear_merge( midi.tracks() );
+  const uint64_t linear_ns = Timer::timestamp_ns() - linear_start;
+
+  const auto& events = midi.events();
+  if ( events.size() != expected.size() or events.size() != TRACK_COUNT * ( 2 * NOTES_PER_TRACK + 1 ) + 2 ) {
+    throw runtime_error( "merged stream has the wrong number of events" );
+  }
+
+  for ( size_t i = 0; i < events.size(); i++ ) {
+    if ( events[i].ticks != expected[i].ticks or events[i].event_type != expected[i].event_type
+         or events[i].channel != expected[i].channel or events[i].key != expected[i].key
+         or events[i].velocity != expected[i].velocity ) {
+      throw runtime_error( "merged stream differs at event " + to_string( i ) );
+    }
+  }
+
+  cout << "Synthetic file with " << TRACK_COUNT << " tracks and " << events.size() << " events\n";
+  cout << "   parse and merge: ";
+  Timer::pp_ns( cout, parse_ns );
+  cout << "\n   linear merge alone: ";
+  Timer::pp_ns( cout, linear_ns );
+  cout << "\n";
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "midi_file.hh"
+
+using namespace std;
+
+static string chunk( const string& type, const string& body )
+{
+  string ret = type;
+  for ( int shift = 24; shift >= 0; shift -= 8 ) {
+    ret.push_back( char( ( body.size() >> shift ) & 0xff ) );
+  }
+  return ret + body;
+}
+
+static string bytes( const vector<uint8_t>& values )
+{
+  return { values.begin(), values.end() };
+}
+
+/* a header with two extra bytes, 96 ticks per beat, and the given number of tracks */
+static string header( const uint8_t track_count )
+{
+  return chunk( "MThd", bytes( { 0, 1, 0, track_count, 0, 96, 0xAB, 0xCD } ) );
+}
+
+static const string tempo_track = chunk( "MTrk",
+                                         bytes( { 0, 0xFF, 0x03, 0x81, 0x02 } ) + string( 130, 'x' ) /* track name */
+                                           + bytes( { 0, 0xFF, 0x58, 0x04, 0x04, 0x02, 0x18, 0x08 } )
+                                           + bytes( { 0, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20 } )
+                                           + bytes( { 0, 0xFF, 0x2F, 0x00 } ) );
+
+static const string note_track = chunk( "MTrk",
+                                        bytes( {
+                                          0,    0xB0, 64, 127, /* sustain pedal */
+                                          0,    0x90, 60, 100, /* C4 down */
+                                          0,    64,   90,      /* E4 down (running status) */
+                                          0,    0xE0, 0,  64,  /* pitch wheel */
+                                          0,    0xD0, 48,      /* channel pressure */
+                                          48,   0x90, 60, 0,   /* C4 up */
+                                          0,    64,   0,       /* E4 up (running status) */
+                                          24,   0x81, 67, 64,  /* G4 up, channel 1 */
+                                          0,    0xFF, 0x2F, 0,
+                                        } ) );
+
+template<class Function>
+static void expect_failure( const string& what, Function&& function )
+{
+  try {
+    function();
+  } catch ( const exception& ) {
+    return;
+  }
+  throw runtime_error( "MIDI parser accepted " + what );
+}
+
+void program_body()
+{
+  const MidiFile midi { "synthetic",
+                        header( 2 ) + tempo_track + chunk( "XUNK", "ignored" ) /* unknown chunk */ + note_track };
+
+  if ( midi.ticks_per_beat() != 96 or midi.tracks().size() != 2 ) {
+    throw runtime_error( "wrong MIDI header" );
+  }
+
+  if ( midi.tracks().at( 0 ).starting_tempo() != 500000 or midi.tracks().at( 1 ).events().size() != 9 ) {
+    throw runtime_error( "wrong MIDI tracks" );
+  }
+
+  const auto& events = midi.events();
+  if ( events.size() != 13 or events.at( 0 ).data.size() != 130 or events.at( 2 ).tempo != 500000 ) {
+    throw runtime_error( "wrong MIDI meta events" );
+  }
+
+  const MidiEvent& running = events.at( 6 );
+  if ( running.event_type != MidiEvent::NoteOn or running.key != 64 or running.velocity != 90
+       or running.channel != 0 ) {
+    throw runtime_error( "wrong running-status event" );
+  }
+
+  const MidiEvent& last_note = events.at( 11 );
+  if ( last_note.event_type != MidiEvent::NoteOff or last_note.key != 67 or last_note.channel != 1
+       or last_note.ticks != 24 ) {
+    throw runtime_error( "wrong note-off event" );
+  }
+
+  if ( midi.time_in_beats() != vector<float> { 0 } or midi.periods() != vector<uint32_t> { 500000 } ) {
+    throw runtime_error( "wrong note times" );
+  }
+
+  const auto& roll = midi.piano_roll();
+  if ( roll.size() != 4 or roll.num_runs() != 2 or not roll[0][60] or not roll[1][64] or roll[2][60]
+       or roll[2][64] ) {
+    throw runtime_error( "wrong piano roll" );
+  }
+
+  /* running status does not carry over from one track to the next */
+  expect_failure( "running status from a previous track", [] {
+    MidiFile( "carried", header( 2 ) + note_track + chunk( "MTrk", bytes( { 0, 60, 100 } ) ) );
+  } );
+
+  /* truncated files and chunks */
+  const string file = header( 2 ) + tempo_track + note_track;
+  expect_failure( "a truncated file", [&] { MidiFile( "truncated", file.substr( 0, file.size() - 3 ) ); } );
+  expect_failure( "a truncated event",
+                  [] { MidiFile( "event", header( 1 ) + chunk( "MTrk", bytes( { 0, 0x90, 60 } ) ) ); } );
+  expect_failure( "a bad magic number", [&] { MidiFile( "magic", "MThx" + file.substr( 4 ) ); } );
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
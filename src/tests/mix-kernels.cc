@@ -0,0 +1,128 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mix_kernels.hh"
+#include "random.hh"
+
+using namespace std;
+using MixKernels::StereoFrame;
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  uniform_real_distribution<float> sample_distribution { -1.5, 1.5 };
+
+  float sample() { return sample_distribution( prng ); }
+};
+
+static vector<StereoFrame> random_frames( const size_t count, RandomState& rng )
+{
+  vector<StereoFrame> frames( count );
+  for ( auto& frame : frames ) {
+    frame = { rng.sample(), rng.sample() };
+  }
+  return frames;
+}
+
+static void check_close( const string& kernel, const vector<StereoFrame>& x, const vector<StereoFrame>& y )
+{
+  for ( size_t i = 0; i < x.size(); i++ ) {
+    if ( fabs( x[i].first - y[i].first ) > 1e-5 or fabs( x[i].second - y[i].second ) > 1e-5 ) {
+      throw runtime_error( "Test '" + kernel + "' failed: " + MixKernels::instruction_set()
+                           + " result differs from scalar at frame " + to_string( i ) );
+    }
+  }
+}
+
+void program_body()
+{
+  RandomState rng;
+
+  /* odd lengths exercise the scalar tail after the vector loop */
+  for ( size_t frames = 0; frames < 100; frames += 7 ) {
+    const auto a = random_frames( frames, rng );
+    const auto b = random_frames( frames, rng );
+    const auto initial = random_frames( frames, rng );
+    const float a_gain = rng.sample(), b_gain = rng.sample();
+
+    {
+      auto vec = initial, scalar = initial;
+      MixKernels::mix( vec.data(), a.data(), a_gain, frames );
+      MixKernels::Scalar::mix( scalar.data(), a.data(), a_gain, frames );
+      check_close( "mix", vec, scalar );
+    }
+
+    {
+      auto vec = initial, scalar = initial;
+      MixKernels::crossfade( vec.data(), a.data(), a_gain, b.data(), b_gain, frames );
+      MixKernels::Scalar::crossfade( scalar.data(), a.data(), a_gain, b.data(), b_gain, frames );
+      check_close( "crossfade", vec, scalar );
+    }
+
+    {
+      auto vec = initial, scalar = initial;
+      MixKernels::crossfade_ramp( vec.data(), a.data(), a_gain, b.data(), b_gain, 0.9, -0.001, frames );
+      MixKernels::Scalar::crossfade_ramp( scalar.data(), a.data(), a_gain, b.data(), b_gain, 0.9, -0.001, frames );
+      check_close( "crossfade_ramp", vec, scalar );
+    }
+
+    {
+      /* includes out-of-range samples, which must clamp rather than wrap */
+      vector<int32_t> vec( 2 * frames ), scalar( 2 * frames );
+      MixKernels::to_int32( vec.data(), a.data(), frames );
+      MixKernels::Scalar::to_int32( scalar.data(), a.data(), frames );
+      if ( vec != scalar ) {
+        throw runtime_error( "Test 'to_int32' failed: " + string( MixKernels::instruction_set() )
+                             + " result differs from scalar" );
+      }
+    }
+
+    {
+      vector<float> left( frames ), right( frames );
+      for ( size_t i = 0; i < frames; i++ ) {
+        left[i] = a[i].first;
+        right[i] = a[i].second;
+      }
+
+      vector<int32_t> planar( 2 * frames ), interleaved( 2 * frames );
+      MixKernels::planar_to_int32( planar.data(), left.data(), right.data(), frames );
+      MixKernels::Scalar::to_int32( interleaved.data(), a.data(), frames );
+      if ( planar != interleaved ) {
+        throw runtime_error( "Test 'planar_to_int32' failed: " + string( MixKernels::instruction_set() )
+                             + " result differs from interleaved conversion" );
+      }
+    }
+  }
+
+  const vector<StereoFrame> extremes { { 1.0, -1.0 }, { 2.0, -2.0 }, { 0.5, -0.5 }, { 0, 0 } };
+  vector<int32_t> converted( 2 * extremes.size() );
+  MixKernels::to_int32( converted.data(), extremes.data(), extremes.size() );
+  if ( converted[0] <= 0 or converted[1] != INT32_MIN or converted[2] != converted[0] or converted[3] != INT32_MIN
+       or converted[4] != 1 << 30 or converted[5] != -( 1 << 30 ) ) {
+    throw runtime_error( "Test 'to_int32' failed: full-scale samples not clamped" );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
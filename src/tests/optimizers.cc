@@ -0,0 +1,123 @@
+#include "optimizers.hh"
+#include "random.hh"
+#include "training.hh"
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  normal_distribution<float> parameter_distribution { 0.0, 0.1 };
+
+  float sample() { return parameter_distribution( prng ); }
+};
+
+template<LayerT Layer>
+void randomize_layer( Layer& layer, RandomState& rng )
+{
+  for ( unsigned int i = 0; i < layer.weights.size(); ++i ) {
+    *( layer.weights.data() + i ) = rng.sample();
+  }
+
+  for ( unsigned int i = 0; i < layer.biases.size(); ++i ) {
+    *( layer.biases.data() + i ) = rng.sample();
+  }
+}
+
+template<NetworkT Network>
+void randomize_network( Network& network, RandomState& rng )
+{
+  randomize_layer( network.first, rng );
+
+  if constexpr ( not Network::is_last ) {
+    randomize_network( network.rest, rng );
+  }
+}
+
+using TestNetwork = Network<float, 4, 16, 2>;
+constexpr int batch_size = 8;
+constexpr size_t step_count = 2000;
+
+// Each optimizer must fit a fixed linear map from random inputs
+template<template<class, int> class Optimizer>
+void test_optimizer( const string& name, RandomState& rng, const float learning_rate )
+{
+  using Training = NetworkTraining<TestNetwork, batch_size, Optimizer>;
+  using Input = typename Training::Input;
+  using Output = typename Training::Output;
+
+  Eigen::Matrix<float, 4, 2> target_map;
+  target_map << 1, -2, 0.5, 3, -1, 0, 2, 1;
+
+  auto nn = make_unique<TestNetwork>();
+  randomize_network( *nn, rng );
+  auto training = make_unique<Training>();
+
+  auto mean_loss = [&]( const Input& input, const Output& expected ) {
+    training->infer->apply( *nn, input );
+    return ( training->infer->output() - expected ).squaredNorm() / expected.size();
+  };
+
+  Input input;
+  Output expected;
+  uniform_real_distribution<float> input_distribution { -1, 1 };
+  auto generate = [&] {
+    for ( int i = 0; i < input.size(); ++i ) {
+      *( input.data() + i ) = input_distribution( rng.prng );
+    }
+    expected = input * target_map;
+  };
+
+  generate();
+  const float loss_before = mean_loss( input, expected );
+
+  for ( size_t i = 0; i < step_count; ++i ) {
+    generate();
+    training->train(
+      *nn, input, [&]( const auto& predicted ) { return predicted - expected; }, learning_rate );
+  }
+
+  generate();
+  const float loss_after = mean_loss( input, expected );
+
+  cout << name << ": loss " << loss_before << " -> " << loss_after << "\n";
+
+  if ( not( loss_after < 0.01 * loss_before ) ) {
+    throw runtime_error( "optimizer " + name + " did not fit the test data" );
+  }
+}
+
+void program_body()
+{
+  RandomState rng;
+
+  test_optimizer<NetworkGradientDescent>( "gradient descent", rng, 0.01 );
+  test_optimizer<NetworkMomentum>( "momentum", rng, 0.001 );
+  test_optimizer<NetworkRMSProp>( "RMSProp", rng, 0.001 );
+  test_optimizer<NetworkAdam>( "Adam", rng, 0.001 );
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
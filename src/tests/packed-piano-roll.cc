@@ -0,0 +1,107 @@
+#include <Eigen/Dense>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include "piano_roll.hh"
+#include "random.hh"
+
+using namespace std;
+
+static constexpr size_t HISTORY = 8;
+static constexpr size_t FIRST_KEY = 21;
+static constexpr size_t KEY_COUNT = 88;
+
+void program_body()
+{
+  default_random_engine prng { get_random_engine() };
+  uniform_int_distribution<size_t> run_length { 1, 64 }, key { 0, 127 }, changes { 0, 6 };
+
+  /* a roll of sustained chords, kept both packed and as floats */
+  PackedPianoRoll packed;
+  PianoRoll<128> unpacked;
+  PackedPianoRollColumn column;
+  PianoRollColumn<128> float_column {};
+  size_t runs = 0;
+  while ( unpacked.size() < 100000 ) {
+    for ( size_t i = changes( prng ); i > 0; i-- ) {
+      const size_t k = key( prng );
+      column.set( k, not column[k] );
+      float_column[k] = column[k] ? PianoRollEvent::NoteDown : PianoRollEvent::NoteUp;
+    }
+
+    const size_t length = run_length( prng );
+    if ( packed.empty() or not( packed.back() == column ) ) {
+      runs++;
+    }
+    packed.push_back( column, length );
+    unpacked.insert( unpacked.end(), length, float_column );
+  }
+
+  if ( packed.size() != unpacked.size() or packed.num_runs() != runs ) {
+    throw runtime_error( "packed roll has the wrong size" );
+  }
+
+  for ( size_t i = 0; i < unpacked.size(); i++ ) {
+    for ( size_t k = 0; k < 128; k++ ) {
+      if ( packed[i][k] != ( unpacked[i][k] == PianoRollEvent::NoteDown ) ) {
+        throw runtime_error( "packed roll differs at column " + to_string( i ) );
+      }
+    }
+  }
+
+  packed.shrink_to_fit();
+  const size_t unpacked_bytes = unpacked.size() * sizeof( PianoRollColumn<128> );
+  if ( packed.memory_usage() * 30 > unpacked_bytes ) {
+    throw runtime_error( "packed roll is not much smaller" );
+  }
+
+  /* unpacking into the network input layouts */
+  Eigen::Matrix<double, 1, KEY_COUNT> keys;
+  Eigen::Matrix<double, 1, HISTORY * KEY_COUNT> history;
+  for ( size_t i = 0; i + HISTORY < unpacked.size(); i += 997 ) {
+    packed[i].unpack( FIRST_KEY, keys );
+    for ( size_t j = 0; j < HISTORY; j++ ) {
+      packed[i + j].unpack( FIRST_KEY, history( Eigen::seqN( j, KEY_COUNT, HISTORY ) ) );
+    }
+
+    for ( size_t k = 0; k < KEY_COUNT; k++ ) {
+      if ( keys( k ) != unpacked[i][k + FIRST_KEY] ) {
+        throw runtime_error( "unpacked keys are wrong" );
+      }
+      for ( size_t j = 0; j < HISTORY; j++ ) {
+        if ( history( k * HISTORY + j ) != unpacked[i + j][k + FIRST_KEY] ) {
+          throw runtime_error( "unpacked history is wrong" );
+        }
+      }
+    }
+  }
+
+  try {
+    packed[0].unpack( 64, keys );
+  } catch ( const out_of_range& ) {
+    return;
+  }
+  throw runtime_error( "unpacked keys past the end of a column" );
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include "dnn_types.hh"
+#include "parallel_training.hh"
+#include "random.hh"
+#include "training.hh"
+
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  normal_distribution<double> parameter_distribution { 0.0, 0.1 };
+
+  double sample() { return parameter_distribution( prng ); }
+};
+
+template<LayerT Layer>
+void randomize_layer( Layer& layer, RandomState& rng )
+{
+  for ( unsigned int i = 0; i < layer.weights.size(); ++i ) {
+    *( layer.weights.data() + i ) = rng.sample();
+  }
+
+  for ( unsigned int i = 0; i < layer.biases.size(); ++i ) {
+    *( layer.biases.data() + i ) = rng.sample();
+  }
+}
+
+template<NetworkT Network>
+void randomize_network( Network& network, RandomState& rng )
+{
+  randomize_layer( network.first, rng );
+
+  if constexpr ( not Network::is_last ) {
+    randomize_network( network.rest, rng );
+  }
+}
+
+template<NetworkT Network>
+double max_difference( const Network& a, const Network& b )
+{
+  double difference = max( ( a.first.weights - b.first.weights ).cwiseAbs().maxCoeff(),
+                           ( a.first.biases - b.first.biases ).cwiseAbs().maxCoeff() );
+
+  if constexpr ( not Network::is_last ) {
+    difference = max( difference, max_difference( a.rest, b.rest ) );
+  }
+
+  return difference;
+}
+
+using TestNetwork = Network<double, 16, 32, 8, 2>;
+
+constexpr int shard_size = 4;
+constexpr size_t num_shards = 7;
+constexpr size_t num_threads = 3;
+constexpr size_t iteration_count = 16;
+constexpr float learning_rate = 0.01;
+
+// One data-parallel step over several shards must match one ordinary step over the whole batch
+void program_body()
+{
+  RandomState rng;
+
+  using Serial = NetworkTraining<TestNetwork, shard_size * num_shards>;
+  using Parallel = ParallelNetworkTraining<TestNetwork, shard_size>;
+
+  auto serial_nn = make_unique<TestNetwork>();
+  auto parallel_nn = make_unique<TestNetwork>();
+  randomize_network( *serial_nn, rng );
+  *parallel_nn = *serial_nn;
+
+  auto serial = make_unique<Serial>();
+  Parallel parallel { num_threads };
+
+  auto input = make_unique<typename Serial::Input>();
+  auto expected = make_unique<typename Serial::Output>();
+  vector<typename Parallel::Input> input_shards( num_shards );
+
+  for ( size_t i = 0; i < iteration_count; ++i ) {
+    input->setRandom();
+    expected->setRandom();
+    for ( size_t shard = 0; shard < num_shards; ++shard ) {
+      input_shards[shard] = input->template middleRows<shard_size>( shard * shard_size );
+    }
+
+    serial->train(
+      *serial_nn, *input, [&]( const auto& predicted ) { return predicted - *expected; }, learning_rate );
+
+    parallel.train(
+      *parallel_nn,
+      input_shards,
+      [&]( const auto& predicted, const size_t shard ) -> typename Parallel::Output {
+        return predicted - expected->template middleRows<shard_size>( shard * shard_size );
+      },
+      learning_rate );
+
+    if ( max_difference( *serial_nn, *parallel_nn ) > 1e-9 ) {
+      throw runtime_error( "data-parallel training diverged from single-threaded training" );
+    }
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
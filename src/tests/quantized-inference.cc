@@ -0,0 +1,132 @@
+#include "binary_network.hh"
+#include "dnn_types.hh"
+#include "inference.hh"
+#include "quantize.hh"
+#include "random.hh"
+
+#include <iostream>
+#include <memory>
+
+using namespace std;
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  normal_distribution<float> parameter_distribution { 0.0, 0.1 };
+
+  float sample() { return parameter_distribution( prng ); }
+};
+
+template<LayerT Layer>
+void randomize_layer( Layer& layer, RandomState& rng )
+{
+  for ( unsigned int i = 0; i < layer.weights.size(); ++i ) {
+    *( layer.weights.data() + i ) = rng.sample();
+  }
+
+  for ( unsigned int i = 0; i < layer.biases.size(); ++i ) {
+    *( layer.biases.data() + i ) = rng.sample();
+  }
+}
+
+template<NetworkT Network>
+void randomize_network( Network& network, RandomState& rng )
+{
+  randomize_layer( network.first, rng );
+
+  if constexpr ( not Network::is_last ) {
+    randomize_network( network.rest, rng );
+  }
+}
+
+constexpr int batch_size = 8;
+
+// Quantized inference must match the dequantized network (the same weights, widened), stay
+// close to the original network, and survive the binary format
+template<NetworkT Network, QuantizedStorageT Storage>
+void test_network( const string& name, const double tolerance, RandomState& rng )
+{
+  using Quantized = typename Network::template Quantized<Storage>;
+  using Infer = NetworkInference<Network, batch_size>;
+  using QuantizedInfer = NetworkInference<Quantized, batch_size>;
+
+  auto nn = make_unique<Network>();
+  randomize_network( *nn, rng );
+
+  auto quantized = make_unique<Quantized>();
+  quantize( *nn, *quantized );
+  auto dequantized = make_unique<Network>();
+  dequantize( *quantized, *dequantized );
+
+  auto input = make_unique<typename Infer::Input>();
+  input->setRandom();
+
+  auto infer = make_unique<Infer>();
+  auto dequantized_infer = make_unique<Infer>();
+  auto quantized_infer = make_unique<QuantizedInfer>();
+  infer->apply( *nn, *input );
+  dequantized_infer->apply( *dequantized, *input );
+  quantized_infer->apply( *quantized, *input );
+
+  const double scale = infer->output().cwiseAbs().maxCoeff();
+
+  if ( ( quantized_infer->output() - dequantized_infer->output() ).cwiseAbs().maxCoeff() > 1e-4 * scale ) {
+    throw runtime_error( name + ": quantized inference differs from the dequantized network" );
+  }
+
+  if ( ( quantized_infer->output() - infer->output() ).cwiseAbs().maxCoeff() > tolerance * scale ) {
+    throw runtime_error( name + ": quantized inference is too far from the original" );
+  }
+
+  const string binary = NetworkBinary::serialize( *quantized );
+  auto parsed = make_unique<Quantized>();
+  NetworkBinary::parse( *parsed, binary, true );
+  if ( not( *parsed == *quantized ) ) {
+    throw runtime_error( name + ": binary roundtrip changed the quantized network" );
+  }
+
+  auto loaded = make_unique<Network>();
+  NetworkBinary::load( *loaded, binary );
+  if ( not( *loaded == *dequantized ) ) {
+    throw runtime_error( name + ": loading a quantized file differs from dequantizing" );
+  }
+
+  try {
+    NetworkBinary::parse( *nn, binary );
+  } catch ( const exception& ) {
+    return;
+  }
+  throw runtime_error( name + ": parsed quantized weights as plain weights" );
+}
+
+void program_body()
+{
+  RandomState rng;
+
+  test_network<DNN_period_16, int8_t>( "DNN_period_16 (int8)", 0.05, rng );
+  test_network<DNN_period_16, Eigen::half>( "DNN_period_16 (fp16)", 0.01, rng );
+  test_network<DNN_piano_roll_prediction, int8_t>( "DNN_piano_roll_prediction (int8)", 0.05, rng );
+  test_network<DNN_piano_roll_prediction, Eigen::half>( "DNN_piano_roll_prediction (fp16)", 0.01, rng );
+  test_network<DNN_piano_roll_octave_prediction, int8_t>( "DNN_piano_roll_octave_prediction (int8)", 0.05, rng );
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+#include "random.hh"
+#include "simplenn.hh"
+
+using namespace std;
+
+static constexpr size_t TIMESLOT_COUNT = 200;
+static constexpr size_t UPDATES_PER_TIMESLOT = 3;
+
+using Column = SimpleNN::Column;
+
+struct RandomState
+{
+  default_random_engine prng { get_random_engine() };
+  normal_distribution<double> parameter_distribution { 0.0, 0.5 };
+  uniform_int_distribution<size_t> key_distribution { 0, 87 };
+
+  double sample() { return parameter_distribution( prng ); }
+  size_t key() { return key_distribution( prng ); }
+};
+
+template<NetworkT Network>
+void randomize_network( Network& network, RandomState& rng )
+{
+  for ( unsigned int i = 0; i < network.first.weights.size(); ++i ) {
+    *( network.first.weights.data() + i ) = rng.sample();
+  }
+
+  for ( unsigned int i = 0; i < network.first.biases.size(); ++i ) {
+    *( network.first.biases.data() + i ) = rng.sample();
+  }
+
+  if constexpr ( not Network::is_last ) {
+    randomize_network( network.rest, rng );
+  }
+}
+
+/* the last HISTORY (or fewer) columns of the roll, leaving out the final `skip` */
+static vector<Column> last_columns( const vector<Column>& roll, const size_t skip )
+{
+  const size_t end = roll.size() - skip;
+  return { roll.begin() + ( end - min( end, SimpleNN::HISTORY ) ), roll.begin() + end };
+}
+
+void program_body()
+{
+  RandomState rng;
+
+  auto nn = make_unique<DNN_piano_roll_prediction>();
+  randomize_network( *nn, rng );
+
+  char filename[] = "/tmp/simplenn-window-XXXXXX";
+  const int fd = mkstemp( filename );
+  if ( fd < 0 ) {
+    throw runtime_error( "mkstemp failed" );
+  }
+  close( fd );
+  {
+    ofstream output { filename, ios::binary };
+    output << NetworkBinary::serialize( *nn );
+  }
+
+  /* both predictors see the same stream, and train on it, so they must agree throughout */
+  SimpleNN streaming { filename }, rebuilding { filename };
+  unlink( filename );
+
+  SimpleNN::Window window;
+  vector<Column> roll { Column {} };
+  size_t keys_predicted = 0;
+
+  for ( size_t timeslot = 0; timeslot < TIMESLOT_COUNT; timeslot++ ) {
+    if ( timeslot > 0 ) {
+      window.advance();
+      roll.push_back( roll.back() );
+    }
+
+    for ( size_t update = 0; update < UPDATES_PER_TIMESLOT; update++ ) {
+      const size_t key = rng.key();
+      roll.back()[key] = not roll.back()[key];
+      window.set_current( roll.back() );
+
+      if ( window.timeslots() != roll.size() ) {
+        throw runtime_error( "window has the wrong number of timeslots" );
+      }
+
+      const vector<Column> history = last_columns( roll, 0 );
+      for ( size_t i = 0; i < history.size(); i++ ) {
+        if ( window.column( SimpleNN::HISTORY - history.size() + i ) != history[i] ) {
+          throw runtime_error( "window has the wrong columns" );
+        }
+      }
+
+      if ( roll.size() >= 2 ) {
+        streaming.train_next_note_values( window );
+        rebuilding.train_next_note_values( last_columns( roll, 1 ), roll.back() );
+      }
+
+      const Column streamed = streaming.predict_next_note_values( window );
+      if ( streamed != rebuilding.predict_next_note_values( history ) ) {
+        throw runtime_error( "streaming prediction differs at timeslot " + to_string( timeslot ) );
+      }
+
+      for ( const bool down : streamed ) {
+        keys_predicted += down;
+      }
+    }
+  }
+
+  /* make sure the comparison wasn't trivial */
+  if ( keys_predicted == 0 or keys_predicted == TIMESLOT_COUNT * UPDATES_PER_TIMESLOT * 88 ) {
+    throw runtime_error( "predictions were all the same" );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "typed_ring_buffer.hh"
+
+using namespace std;
+
+static constexpr uint64_t ELEMENT_COUNT = 1000000;
+
+void program_body()
+{
+  SPSCRingBuffer<uint64_t> queue { 4096 };
+
+  /* the writer pushes consecutive integers in batches of varying size */
+  thread writer { [&] {
+    uint64_t next = 0;
+    while ( next < ELEMENT_COUNT ) {
+      span<uint64_t> space = queue.writable_region();
+      if ( space.size() == 0 ) {
+        this_thread::yield();
+        continue;
+      }
+      const size_t batch = min( { space.size(), size_t( next % 37 + 1 ), size_t( ELEMENT_COUNT - next ) } );
+      for ( size_t i = 0; i < batch; i++ ) {
+        space[i] = next++;
+      }
+      queue.push( batch );
+    }
+  } };
+
+  /* the reader must see every one of them, in order */
+  uint64_t expected = 0;
+  while ( expected < ELEMENT_COUNT ) {
+    const span_view<uint64_t> elements = queue.readable_region();
+    if ( elements.size() == 0 ) {
+      this_thread::yield();
+      continue;
+    }
+    for ( const auto x : elements ) {
+      if ( x != expected ) {
+        writer.detach();
+        throw runtime_error( "Test failed: read " + to_string( x ) + ", expected " + to_string( expected ) );
+      }
+      expected++;
+    }
+    queue.pop( elements.size() );
+  }
+
+  writer.join();
+
+  if ( queue.readable_region().size() != 0 ) {
+    throw runtime_error( "Test failed: elements left over" );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 0 ) {
+    abort();
+  }
+
+  if ( argc != 1 ) {
+    cerr << "Usage: " << argv[0] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A BatchQueue prepares training batches ahead of the thread that consumes them. A fixed number
+// of batches (`depth`, 2 for double buffering) is allocated up front and recycled: producer
+// threads fill free batches with `fill`, and next() hands out filled ones. The producers stall
+// when every batch is filled and not yet consumed, so at most `depth` batches are ever in memory.
+//
+// `fill` is called from the producer threads, so anything it changes (e.g. a random number
+// generator) must be per-thread. An exception thrown by `fill` is rethrown by next().
+template<class Batch>
+class BatchQueue
+{
+public:
+  using Fill = std::function<void( Batch& )>;
+
+  explicit BatchQueue( Fill fill, const size_t depth = 2, const size_t num_producers = 1 )
+    : fill_( std::move( fill ) )
+  {
+    for ( size_t i = 0; i < std::max<size_t>( depth, 1 ); i++ ) {
+      batches_.push_back( std::make_unique<Batch>() );
+      free_.push_back( batches_.back().get() );
+    }
+
+    for ( size_t i = 0; i < std::max<size_t>( num_producers, 1 ); i++ ) {
+      producers_.emplace_back( [this] { produce(); } );
+    }
+  }
+
+  ~BatchQueue()
+  {
+    {
+      std::lock_guard lock { mutex_ };
+      stopping_ = true;
+    }
+    batch_freed_.notify_all();
+
+    for ( auto& producer : producers_ ) {
+      producer.join();
+    }
+  }
+
+  // Wait for the next filled batch. It stays valid (and is not refilled) until the next call.
+  const Batch& next()
+  {
+    std::unique_lock lock { mutex_ };
+
+    if ( current_ ) {
+      free_.push_back( current_ );
+      current_ = nullptr;
+      batch_freed_.notify_one();
+    }
+
+    batch_filled_.wait( lock, [&] { return not filled_.empty() or error_; } );
+
+    if ( error_ ) {
+      std::rethrow_exception( error_ );
+    }
+
+    current_ = filled_.front();
+    filled_.pop_front();
+    return *current_;
+  }
+
+  BatchQueue( const BatchQueue& other ) = delete;
+  BatchQueue& operator=( const BatchQueue& other ) = delete;
+
+private:
+  Fill fill_;
+
+  std::vector<std::unique_ptr<Batch>> batches_ {};
+  std::deque<Batch*> free_ {}, filled_ {};
+  Batch* current_ {};
+
+  std::mutex mutex_ {};
+  std::condition_variable batch_freed_ {}, batch_filled_ {};
+  bool stopping_ {};
+  std::exception_ptr error_ {};
+
+  std::vector<std::thread> producers_ {};
+
+  void produce()
+  {
+    while ( true ) {
+      Batch* batch {};
+      {
+        std::unique_lock lock { mutex_ };
+        batch_freed_.wait( lock, [&] { return not free_.empty() or stopping_; } );
+        if ( stopping_ ) {
+          return;
+        }
+        batch = free_.front();
+        free_.pop_front();
+      }
+
+      try {
+        fill_( *batch );
+      } catch ( ... ) {
+        std::lock_guard lock { mutex_ };
+        if ( not error_ ) {
+          error_ = std::current_exception();
+        }
+        batch_filled_.notify_all();
+        return;
+      }
+
+      {
+        std::lock_guard lock { mutex_ };
+        filled_.push_back( batch );
+      }
+      batch_filled_.notify_one();
+    }
+  }
+};
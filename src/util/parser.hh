@@ -54,6 +54,15 @@ public:
     input_.remove_prefix( out.size() );
   }
 
+  /* the next `size` bytes of the input, without copying */
+  std::string_view bytes( const size_t size )
+  {
+    check_size( size );
+    const std::string_view ret = input_.substr( 0, size );
+    input_.remove_prefix( size );
+    return ret;
+  }
+
   template<typename T>
   void object( T& out )
   {
@@ -33,11 +33,13 @@ public:
 template<typename T>
 class span_view
 {
-  std::string_view storage_;
+  std::string_view storage_ {};
 
   static constexpr auto elem_size_ = sizeof( T );
 
 public:
+  span_view() = default;
+
   span_view( const T* addr, const size_t len )
     : storage_( reinterpret_cast<const char*>( addr ), len * elem_size_ )
   {}
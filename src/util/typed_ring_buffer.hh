@@ -5,6 +5,7 @@
 #include "spans.hh"
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 
 template<typename T>
@@ -73,6 +74,52 @@ public:
   }
 };
 
+// Like TypedRingBuffer, but one thread may write (writable_region/push) while another reads (readable_region/pop)
+// without locks. Elements are published to the reader by push() and handed back to the writer by pop().
+template<typename T>
+class SPSCRingBuffer : public TypedRingStorage<T>
+{
+  std::atomic<size_t> num_pushed_ { 0 }, num_popped_ { 0 };
+
+public:
+  using TypedRingStorage<T>::TypedRingStorage;
+  using TypedRingStorage<T>::capacity;
+
+  /* writer side */
+  span<T> writable_region()
+  {
+    const size_t pushed = num_pushed_.load( std::memory_order_relaxed );
+    const size_t popped = num_popped_.load( std::memory_order_acquire );
+    return TypedRingStorage<T>::mutable_storage( pushed % capacity() ).substr( 0, capacity() - ( pushed - popped ) );
+  }
+
+  void push( const size_t num_elems )
+  {
+    if ( num_elems > writable_region().size() ) {
+      throw std::runtime_error( "SPSCRingBuffer::push exceeded size of writable region" );
+    }
+
+    num_pushed_.store( num_pushed_.load( std::memory_order_relaxed ) + num_elems, std::memory_order_release );
+  }
+
+  /* reader side */
+  span_view<T> readable_region() const
+  {
+    const size_t popped = num_popped_.load( std::memory_order_relaxed );
+    const size_t pushed = num_pushed_.load( std::memory_order_acquire );
+    return TypedRingStorage<T>::storage( popped % capacity() ).substr( 0, pushed - popped );
+  }
+
+  void pop( const size_t num_elems )
+  {
+    if ( num_elems > readable_region().size() ) {
+      throw std::runtime_error( "SPSCRingBuffer::pop exceeded size of readable region" );
+    }
+
+    num_popped_.store( num_popped_.load( std::memory_order_relaxed ) + num_elems, std::memory_order_release );
+  }
+};
+
 template<typename T>
 class EndlessBuffer : TypedRingStorage<T>
 {